@@ -17,6 +17,7 @@
 
 #include <chrono>
 #include <iostream>
+#include <map>
 #include <numeric>
 #include <thread>
 #include <unordered_map>
@@ -66,7 +67,13 @@ class LlaBench : public AliceO2::Common::Program
                           "Number of threds to spawn");
     options.add_options()("lock-type",
                           po::value<std::string>(&mOptions.lockTypeString)->default_value("socket-lock"),
-                          "Type of lock to use ['socket-lock','named-mutex']");
+                          "Type of lock to use ['socket-lock','named-mutex','file-lock','futex-lock','robust-mutex','ticket-lock']");
+    options.add_options()("wait-strategy",
+                          po::value<std::string>(&mOptions.waitStrategyString)->default_value("park"),
+                          "How to wait for the lock ['spin','spin-yield','backoff','park']");
+    options.add_options()("bias-grace-period",
+                          po::value<int>(&mOptions.biasGracePeriod)->default_value(0),
+                          "Time in ms for which a stopped session keeps the lock (0 disables biased locking)");
     options.add_options()("simple-critical",
                           po::bool_switch(&mOptions.simpleCritical)->default_value(false),
                           "Enables simple critical section instead of SWT");
@@ -86,6 +93,17 @@ class LlaBench : public AliceO2::Common::Program
       runForever = true;
     }
 
+    const std::map<std::string, WaitStrategy::Type> waitStrategies = {
+      { "spin", WaitStrategy::Spin },
+      { "spin-yield", WaitStrategy::SpinYield },
+      { "backoff", WaitStrategy::Backoff },
+      { "park", WaitStrategy::Park }
+    };
+    if (waitStrategies.find(mOptions.waitStrategyString) == waitStrategies.end()) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Unknown wait strategy " + mOptions.waitStrategyString));
+    }
+    waitStrategy = waitStrategies.at(mOptions.waitStrategyString);
+
     std::cout << "Running Low-Level Arbitration Benchmarking program" << std::endl;
 
     std::cout << "-------------------------------------------------" << std::endl;
@@ -102,6 +120,34 @@ class LlaBench : public AliceO2::Common::Program
     runBenchmark(std::bind(&LlaBench::lockingOverhead, this, 100)); // TODO: Add program arguments for this
     std::cout << std::endl;
     runBenchmark(std::bind(&LlaBench::criticalSectionTimes, this));
+    std::cout << "-------------------------------------------------" << std::endl;
+    std::cout << "=================== FILE LOCK ===================" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+    lockType = LockType::Type::FileLock;
+    runBenchmark(std::bind(&LlaBench::lockingOverhead, this, 100));
+    std::cout << std::endl;
+    runBenchmark(std::bind(&LlaBench::criticalSectionTimes, this));
+    std::cout << "-------------------------------------------------" << std::endl;
+    std::cout << "=================== FUTEX LOCK ==================" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+    lockType = LockType::Type::FutexLock;
+    runBenchmark(std::bind(&LlaBench::lockingOverhead, this, 100));
+    std::cout << std::endl;
+    runBenchmark(std::bind(&LlaBench::criticalSectionTimes, this));
+    std::cout << "-------------------------------------------------" << std::endl;
+    std::cout << "================== ROBUST MUTEX =================" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+    lockType = LockType::Type::RobustMutex;
+    runBenchmark(std::bind(&LlaBench::lockingOverhead, this, 100));
+    std::cout << std::endl;
+    runBenchmark(std::bind(&LlaBench::criticalSectionTimes, this));
+    std::cout << "-------------------------------------------------" << std::endl;
+    std::cout << "================== TICKET LOCK ==================" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+    lockType = LockType::Type::TicketLock;
+    runBenchmark(std::bind(&LlaBench::lockingOverhead, this, 100));
+    std::cout << std::endl;
+    runBenchmark(std::bind(&LlaBench::criticalSectionTimes, this));
     return;
   }
 
@@ -237,7 +283,9 @@ class LlaBench : public AliceO2::Common::Program
 
     SessionParameters params = SessionParameters::makeParameters()
                                  .setSessionName(mOptions.sessionName)
-                                 .setCardId(mOptions.cardId);
+                                 .setCardId(mOptions.cardId)
+                                 .setWaitStrategy(waitStrategy)
+                                 .setBiasGracePeriod(mOptions.biasGracePeriod);
     std::unique_ptr<Session> session = std::make_unique<Session>(params, lockType); // Class constructor only availabe when O2_LLA_BENCH_ENABLED is defined
 
     std::shared_ptr<roc::BarInterface> bar0, bar2;
@@ -379,6 +427,8 @@ class LlaBench : public AliceO2::Common::Program
     bool noLocking = false;
     int threads = 1;
     std::string lockTypeString = "socket-lock";
+    std::string waitStrategyString = "park";
+    int biasGracePeriod = 0;
     bool simpleCritical = false;
     int operations = 1; // Number of operations to run within a critical section
   } mOptions;
@@ -388,6 +438,7 @@ class LlaBench : public AliceO2::Common::Program
   std::chrono::steady_clock::time_point startCounting;
 
   LockType::Type lockType = LockType::Type::SocketLock;
+  WaitStrategy::Type waitStrategy = WaitStrategy::Park;
 };
 
 } // namespace lla
@@ -0,0 +1,277 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file BasicSession.h
+/// \brief Definition of the BasicSession class template.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_BASICSESSION_H
+#define O2_LLA_INC_BASICSESSION_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "Lla/Exception.h"
+#include "Lla/LockParameters.h"
+#include "Lla/SessionParameters.h"
+#include "Lla/Locks/InterprocessLockBase.h"
+
+namespace o2
+{
+namespace lla
+{
+
+class CardArbiter;
+class CardQuota;
+class CardSchedule;
+class LockHierarchy;
+
+namespace detail
+{
+struct Handoff;
+struct Lease;
+struct WaitQueue;
+
+/// Checks the required Session parameters, and makes the parameters of the lock of the card
+/// \throws o2::lla::ParameterException if a required parameter is missing or the card can't be found
+LockParameters makeLockParameters(const SessionParameters& params);
+
+/// What a BasicSession shares with the Sessions on its card, beside the card lock: the lock type,
+/// the locks of the endpoints and of the hierarchy, the leases, the handoffs, the queue, the
+/// Schedule and the HoldQuotas
+class CardState
+{
+ public:
+  /// \throws o2::lla::ParameterException if processes alive use another lock type on the card, or
+  /// its Schedule has no slot for ClientClass::Control
+  CardState(const SessionParameters& params, LockType::Type lockType);
+  ~CardState();
+
+  /// Holding the card lock, checks that the card's Schedule, if any, is in a slot of
+  /// ClientClass::Control, and that the class is within its HoldQuota, if any; takes the endpoints and the hierarchy if Sessions use them; and checks
+  /// that the card isn't leased, kept for another Session, nor waited for by one that comes first
+  /// \param timeOut In ms, for the endpoints and the hierarchy; negative to try once
+  /// \return LockStatus::Acquired; otherwise the caller releases the card lock, and may wait()
+  LockStatus::Type admit(int timeOut);
+
+  /// Waits until what kept the card from admit() may have gone, for at most the timeout in ms
+  void wait(int timeOut);
+
+  /// Releases what admit() took, before the card lock, and charges the time held to the quota
+  void release();
+
+  /// Takes a place in the queue for a wait, or gives it up
+  void enqueue();
+  void leaveQueue();
+
+ private:
+  std::string mSessionName;
+  SessionParameters mParams;
+  LockType::Type mLockType;
+  int mSerial;
+  std::shared_ptr<const void> mLockTypeUse;
+  std::shared_ptr<std::atomic<uint32_t>> mEndpointUsage;
+  std::array<std::shared_ptr<CardArbiter>, 2> mEndpointArbiters;
+  bool mEndpointsHeld = false;
+  std::shared_ptr<LockHierarchy> mHierarchy;
+  uint32_t mHierarchyTicket = 0;
+  std::shared_ptr<Handoff> mHandoff;
+  std::shared_ptr<Lease> mLease;
+  std::shared_ptr<WaitQueue> mQueue;
+  int mQueueEntry = -1;
+  std::shared_ptr<CardSchedule> mSchedule;
+  std::shared_ptr<CardQuota> mQuota;
+  int mHoldQuota = 0; // Of ClientClass::Control while admitted, charged at the release
+  std::chrono::steady_clock::time_point mStartTime;
+  std::atomic<uint32_t>* mBlocking = nullptr; // What kept the card from admit(), if anything to wait on
+  uint32_t mBlockingWord = 0;
+  std::chrono::nanoseconds mBlockingLeft{ 0 }; // Up to the next slot, without anything to wait on
+};
+} // namespace detail
+
+/// Session with the lock implementation chosen at compile time
+///
+/// The lock is held by value and called without virtual dispatch, so that starting and stopping
+/// don't allocate, and the uncontended paths of header-only locks (e.g. FutexLock) are inlined.
+/// It excludes the Sessions on the card, in this or other processes, as a Session locking the whole
+/// card exclusively does: it takes the endpoints and the hierarchy when Sessions on endpoints, links
+/// or register groups are around, waits for leases and handoffs to other Sessions, and waits in the
+/// queue behind Sessions that come first. LockPolicy has to be the lock type the card is used with.
+/// BiasGracePeriod and Reentrant are ignored, and a BasicSession may only be used by one thread at
+/// a time. It waits in the queue with the default priority, and doesn't take the parameters of
+/// leases, priorities, quotas or schedules; it follows the card's Schedule and HoldQuota of
+/// ClientClass::Control, as set by Sessions.
+///
+/// \tparam LockPolicy One of the lock implementations of Lla/Locks
+template <typename LockPolicy>
+class BasicSession
+{
+  static_assert(std::is_base_of<InterprocessLockBase, LockPolicy>::value,
+                "LockPolicy has to be a lock implementation");
+
+ public:
+  /// BasicSession constructor
+  /// \param params The Session parameters
+  /// \throws o2::lla::ParameterException if the parameters select part of the card, or ask for a
+  /// lease, a place in the queue, a quota or a schedule
+  /// \throws o2::lla::ParameterException if processes alive use another lock type on the card
+  BasicSession(const SessionParameters& params)
+    : mCard(params, LockPolicy::kLockType),
+      mLock(detail::makeLockParameters(params))
+  {
+    if (params.getLockGranularity().get_value_or(LockGranularity::Card) != LockGranularity::Card || params.getLinkId() ||
+        params.getAccessMode().get_value_or(AccessMode::Exclusive) != AccessMode::Exclusive) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("BasicSession only locks whole cards exclusively"));
+    }
+    if (params.getLeaseTime() || params.getPriority() || params.getPreemptTimeOut() || params.getClientClass() ||
+        params.getHoldQuota() || params.getSchedule()) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("BasicSession doesn't support leases, priorities, quotas or schedules"));
+    }
+  }
+
+  BasicSession(const BasicSession& other) = delete;
+  BasicSession& operator=(const BasicSession& other) = delete;
+
+  /* Make sure that the session is stopped, so the lock is released */
+  ~BasicSession()
+  {
+    stop();
+  }
+
+  /// Start a Session, within which atomic access to the card's SC interface is guaranteed
+  /// \return boolean; true if successful, otherwise False
+  bool start()
+  {
+    State state = State::Stopped;
+    if (!mState.compare_exchange_strong(state, State::Starting)) {
+      return state == State::Started;
+    }
+
+    bool started;
+    try {
+      started = acquire(-1) == LockStatus::Acquired;
+    } catch (...) {
+      mState.store(State::Stopped, std::memory_order_release);
+      throw;
+    }
+    mState.store(started ? State::Started : State::Stopped, std::memory_order_release);
+    return started;
+  }
+
+  /// Start a Session, trying until the timeOut has expired
+  /// \param timeOut Timeout in ms after which to stop trying to start the session
+  /// \return boolean; true if successful, otherwise false
+  bool timedStart(int timeOut)
+  {
+    State state = State::Stopped;
+    if (!mState.compare_exchange_strong(state, State::Starting)) {
+      return state == State::Started;
+    }
+
+    // Queued for the whole wait, so that Sessions coming later don't overtake it
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+    auto remaining = [&]() {
+      auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+      return std::max<int>(0, left);
+    };
+    bool started = false;
+    try {
+      mCard.enqueue();
+      while (true) {
+        auto status = acquire(remaining());
+        if (status == LockStatus::Acquired) {
+          started = true;
+          break;
+        } else if (status == LockStatus::TimedOut || remaining() == 0) {
+          break;
+        }
+        mCard.wait(remaining());
+      }
+    } catch (...) {
+      mCard.leaveQueue();
+      mState.store(State::Stopped, std::memory_order_release);
+      throw;
+    }
+    mCard.leaveQueue();
+    mState.store(started ? State::Started : State::Stopped, std::memory_order_release);
+    return started;
+  }
+
+  /// Stops a Session, releasing atomic access to the card's SC interface
+  void stop()
+  {
+    State state = State::Started;
+    while (!mState.compare_exchange_weak(state, State::Stopping)) {
+      if (state == State::Stopped) {
+        return;
+      }
+      std::this_thread::yield();
+      state = State::Started;
+    }
+
+    mCard.release();
+    mLock.unlock();
+    mState.store(State::Stopped, std::memory_order_release);
+  }
+
+  /// Reports on the state of the Session
+  /// \return boolean; true if started, false otherwise
+  bool isStarted() const
+  {
+    return mState.load(std::memory_order_acquire) == State::Started;
+  }
+
+ private:
+  enum class State {
+    Stopped,
+    Starting,
+    Started,
+    Stopping
+  };
+
+  /// Takes the card lock, then the rest of what the Sessions on the card exclude each other with
+  /// \param timeOut In ms; negative to try once
+  LockStatus::Type acquire(int timeOut)
+  {
+    auto status = timeOut < 0 ? mLock.tryAcquire() : mLock.timedAcquire(timeOut);
+    if (status != LockStatus::Acquired) {
+      return status;
+    }
+    try {
+      status = mCard.admit(timeOut);
+    } catch (...) {
+      mLock.unlock();
+      throw;
+    }
+    if (status != LockStatus::Acquired) {
+      mLock.unlock();
+    }
+    return status;
+  }
+
+  detail::CardState mCard;
+  LockPolicy mLock;
+  std::atomic<State> mState{ State::Stopped };
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_BASICSESSION_H
@@ -31,6 +31,10 @@ struct LlaException : AliceO2::Common::Exception {
 struct ParameterException : AliceO2::Common::Exception {
 };
 
+/// Thrown by a timed start whose wait would close a cycle of Sessions waiting for each other
+struct DeadlockException : AliceO2::Common::Exception {
+};
+
 namespace ErrorInfo
 {
 using Message = AliceO2::Common::ErrorInfo::Message;
@@ -23,6 +23,16 @@ namespace o2
 namespace lla
 {
 
+/// Outcome of a lock acquisition attempt
+struct LockStatus {
+  enum Type {
+    Acquired,      ///< The lock was taken
+    Busy,          ///< The lock is held by someone else
+    TimedOut,      ///< The lock was still held by someone else when the timeout expired
+    AlreadyLocked  ///< This lock object already holds the lock
+  };
+};
+
 class InterprocessLockInterface
 {
 
@@ -34,6 +44,16 @@ class InterprocessLockInterface
   virtual bool tryLock() = 0;
   virtual bool timedLock(int timeOut) = 0;
   virtual void unlock() = 0;
+
+  /// Attempts to take the lock once; contention is reported through the status, not an exception
+  virtual LockStatus::Type tryAcquire() = 0;
+
+  /// Attempts to take the lock until timeOut ms expire; contention is reported through the status, not an exception
+  virtual LockStatus::Type timedAcquire(int timeOut) = 0;
+
+  /// Sleeps while the lock is held, until someone else starts waiting for it or the timeout expires
+  /// \return true if someone is waiting for the lock, false if nobody is or it can't be told
+  virtual bool waitForContention(int timeOut) = 0;
 };
 
 } // namespace lla
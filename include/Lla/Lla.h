@@ -18,7 +18,9 @@
 #ifndef O2_LLA_INC_LLA_H
 #define O2_LLA_INC_LLA_H
 
+#include "Lla/BasicSession.h"
 #include "Lla/Exception.h"
 #include "Lla/Session.h"
+#include "Lla/SessionGroup.h"
 
 #endif // O2_LLA_INC_LLA_H
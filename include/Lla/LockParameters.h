@@ -18,18 +18,34 @@
 #ifndef O2_LLA_INC_LOCKPARAMETERS_H
 #define O2_LLA_INC_LOCKPARAMETERS_H
 
+#include <cstddef>
+#include <string>
 #include <boost/optional.hpp>
-#include <boost/variant.hpp>
 
 #include "Lla/ParameterTypes/LockType.h"
+#include "Lla/ParameterTypes/WaitStrategy.h"
 
 namespace o2
 {
 namespace lla
 {
 
-struct ParametersPimpl;
+class LockParameters;
 
+namespace detail
+{
+/// Makes the parameters of the lock of a card, or of one of its endpoints
+///
+/// Their names are reserved: Sessions only hold the card through its shared state, e.g. a lease,
+/// while the lock is free, so the lock alone doesn't exclude them.
+/// \param endpoint The endpoint, or -1 for the whole card
+LockParameters cardLockParameters(int serial, int endpoint);
+} // namespace detail
+
+/// Class holding Lock Parameters
+///
+/// The parameters are stored inline, the LockName in a fixed buffer, so that making and copying
+/// them doesn't allocate.
 class LockParameters
 {
  public:
@@ -40,21 +56,36 @@ class LockParameters
   LockParameters& operator=(const LockParameters(&other));
   LockParameters& operator=(LockParameters&& other);
 
+  /// Maximum length of the LockName; longer names are shortened to it
+  static constexpr std::size_t kMaxLockNameLength = 63;
+
   // Types for parameter values
   using LockTypeType = LockType::Type;
   using LockNameType = std::string;
+  using WaitStrategyType = WaitStrategy::Type;
 
   // Setters
   auto setLockType(LockTypeType value) -> LockParameters&;
-  auto setLockName(LockNameType value) -> LockParameters&;
+  /// Names longer than kMaxLockNameLength keep their beginning, and end in a hash of the whole name
+  /// \throws o2::lla::ParameterException if the name of the lock of a card, reserved for Sessions
+  auto setLockName(const LockNameType& value) -> LockParameters&;
+  /// \throws o2::lla::ParameterException if the name of the lock of a card, reserved for Sessions
+  auto setLockName(const char* value) -> LockParameters&;
+  auto setWaitStrategy(WaitStrategyType value) -> LockParameters&;
 
   // Optional Getters
   auto getLockType() const -> boost::optional<LockTypeType>;
   auto getLockName() const -> boost::optional<LockNameType>;
+  auto getWaitStrategy() const -> boost::optional<WaitStrategyType>;
 
   // Throwing Getters
   auto getLockTypeRequired() const -> LockTypeType;
   auto getLockNameRequired() const -> LockNameType;
+  auto getWaitStrategyRequired() const -> WaitStrategyType;
+
+  /// Gets the LockName parameter without copying it
+  /// \return The name, or nullptr if not set
+  auto getLockNameView() const -> const char*;
 
   static LockParameters makeParameters(LockTypeType lockType)
   {
@@ -67,7 +98,12 @@ class LockParameters
   }
 
  private:
-  std::unique_ptr<ParametersPimpl> mPimpl;
+  friend LockParameters detail::cardLockParameters(int serial, int endpoint);
+
+  boost::optional<LockTypeType> mLockType;
+  boost::optional<WaitStrategyType> mWaitStrategy;
+  bool mHasLockName = false;
+  char mLockName[kMaxLockNameLength + 1] = {};
 };
 
 } // namespace lla
@@ -0,0 +1,57 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file FileLock.h
+/// \brief Definition of the FileLock class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_FILELOCK_H
+#define O2_LLA_INC_FILELOCK_H
+
+#include "Lla/Locks/InterprocessLockBase.h"
+
+#define FILE_LOCK_DIRECTORY "/dev/shm/"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Lock based on Open File Description (OFD) locks on a file under FILE_LOCK_DIRECTORY
+///
+/// Contrary to the SocketLock, the lock is visible across network namespaces, as long as the
+/// lock directory is shared. Waiters block in the kernel; timed waits are bounded by a
+/// per-thread timer interrupting the blocking fcntl(), with a real-time signal. If the application
+/// ignores that signal, or handles it with SA_RESTART, timed waits poll instead.
+class FileLock final : public InterprocessLockBase
+{
+ public:
+  /// The LockType selecting this implementation, which a BasicSession records for the card
+  static constexpr LockType::Type kLockType = LockType::FileLock;
+
+  FileLock(const LockParameters& params);
+  virtual ~FileLock() override;
+  virtual LockStatus::Type tryAcquire() override;
+  virtual LockStatus::Type timedAcquire(int timeOut) override;
+  virtual void unlock() override;
+
+ private:
+  int mFileFd = -1;
+  std::string mFileLockPath;
+  bool mLocked = false;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_FILELOCK_H
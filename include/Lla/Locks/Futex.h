@@ -0,0 +1,115 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Futex.h
+/// \brief Thin wrappers around the futex system call, for words living in shared memory.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_FUTEX_H
+#define O2_LLA_INC_FUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cerrno>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace o2
+{
+namespace lla
+{
+namespace futex
+{
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32-bit integers");
+
+/// Sleeps as long as the word holds the expected value, until woken up or the timeout expires
+/// The operation is not private, so that it works across processes mapping the same word
+inline void wait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::nanoseconds timeOut)
+{
+  if (timeOut.count() <= 0) {
+    return;
+  }
+  timespec ts;
+  ts.tv_sec = timeOut.count() / 1000000000;
+  ts.tv_nsec = timeOut.count() % 1000000000;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+/// Sleeps as long as the word holds the expected value, until woken up
+inline void wait(std::atomic<uint32_t>* word, uint32_t expected)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+#ifdef FUTEX_WAITV_MAX
+constexpr int kMaxWaitAny = FUTEX_WAITV_MAX;
+#else
+constexpr int kMaxWaitAny = 128;
+#endif
+
+/// Sleeps as long as each of the words holds its expected value, until one of them is woken up or
+/// the timeout expires
+/// \param count Number of words, up to kMaxWaitAny
+/// \return false if the kernel can't wait on several words (futex_waitv, since Linux 5.16)
+inline bool waitAny(std::atomic<uint32_t>* const* words, const uint32_t* expected, int count, std::chrono::nanoseconds timeOut)
+{
+#if defined(SYS_futex_waitv) && defined(FUTEX_32)
+  if (timeOut.count() <= 0 || count <= 0) {
+    return true;
+  }
+  futex_waitv waiters[kMaxWaitAny] = {};
+  count = count < kMaxWaitAny ? count : kMaxWaitAny;
+  for (int i = 0; i < count; ++i) {
+    waiters[i].val = expected[i];
+    waiters[i].uaddr = reinterpret_cast<uintptr_t>(words[i]);
+    waiters[i].flags = FUTEX_32; // Not private, as for wait()
+  }
+
+  // The timeout of futex_waitv is absolute
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  auto deadline = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec) + timeOut;
+  ts.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(deadline).count();
+  ts.tv_nsec = (deadline - std::chrono::seconds(ts.tv_sec)).count();
+  return syscall(SYS_futex_waitv, waiters, count, 0, &ts, CLOCK_MONOTONIC) != -1 || errno != ENOSYS;
+#else
+  (void)words;
+  (void)expected;
+  (void)count;
+  (void)timeOut;
+  return false;
+#endif
+}
+
+/// Wakes up to count waiters sleeping on the word
+inline void wake(std::atomic<uint32_t>* word, int count = 1)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+/// Wakes all waiters sleeping on the word
+inline void wakeAll(std::atomic<uint32_t>* word)
+{
+  wake(word, INT_MAX);
+}
+
+} // namespace futex
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_FUTEX_H
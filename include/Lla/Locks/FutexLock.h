@@ -0,0 +1,92 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file FutexLock.h
+/// \brief Definition of the FutexLock class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_FUTEXLOCK_H
+#define O2_LLA_INC_FUTEXLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "Lla/Locks/Futex.h"
+#include "Lla/Locks/InterprocessLockBase.h"
+#include "Lla/Locks/SharedMemory.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Lock on a single 32-bit futex word kept in a per-card shared memory segment
+///
+/// An uncontended lock or unlock is a single atomic operation; contended waiters sleep in
+/// FUTEX_WAIT. The word is 0 when free, 1 when locked and 2 when locked with (possible) waiters.
+/// Note that the lock is not robust: a holder dying keeps it locked.
+/// The uncontended paths are inline, so that they can be inlined into a BasicSession<FutexLock>.
+class FutexLock final : public InterprocessLockBase
+{
+ public:
+  /// The LockType selecting this implementation, which a BasicSession records for the card
+  static constexpr LockType::Type kLockType = LockType::FutexLock;
+
+  FutexLock(const LockParameters& params);
+  virtual ~FutexLock() override;
+  virtual LockStatus::Type tryAcquire() override;
+  virtual LockStatus::Type timedAcquire(int timeOut) override;
+  virtual bool waitForContention(int timeOut) override;
+  virtual void unlock() override;
+
+ private:
+  enum : uint32_t {
+    Free = 0,
+    Locked = 1,
+    Contended = 2
+  };
+
+  struct FutexWord {
+    std::atomic<uint32_t> word;
+  };
+
+  SharedMemory<FutexWord> mShared;
+  bool mLocked = false;
+};
+
+inline LockStatus::Type FutexLock::tryAcquire()
+{
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  }
+
+  uint32_t expected = Free;
+  mLocked = mShared->word.compare_exchange_strong(expected, Locked, std::memory_order_acquire);
+  return mLocked ? LockStatus::Acquired : LockStatus::Busy;
+}
+
+inline void FutexLock::unlock()
+{
+  if (mLocked) {
+    mLocked = false;
+    if (mShared->word.fetch_sub(1, std::memory_order_release) != Locked) {
+      mShared->word.store(Free, std::memory_order_release);
+      futex::wake(&mShared->word);
+    }
+  }
+}
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_FUTEXLOCK_H
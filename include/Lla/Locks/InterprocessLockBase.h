@@ -15,8 +15,8 @@
 ///
 /// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
 
-#ifndef O2_LLA_SRC_INTERPROCESSLOCKBASE_h
-#define O2_LLA_SRC_INTERPROCESSLOCKBASE_h
+#ifndef O2_LLA_INC_INTERPROCESSLOCKBASE_H
+#define O2_LLA_INC_INTERPROCESSLOCKBASE_H
 
 #include <thread>
 
@@ -35,8 +35,20 @@ class InterprocessLockBase : public InterprocessLockInterface
   InterprocessLockBase(const LockParameters& params);
   ~InterprocessLockBase();
 
+  /// Throws if the lock couldn't be taken
+  virtual void lock() override;
+  virtual bool tryLock() override;
+  virtual bool timedLock(int timeOut) override;
+
+  /// Sleeps for the whole timeout; backends that can detect waiters override it
+  virtual bool waitForContention(int timeOut) override;
+
  protected:
+  /// Retries tryAcquire() until the timeout expires, pacing the attempts according to the wait strategy
+  LockStatus::Type retryLock(int timeOut);
+
   std::string mLockName;
+  WaitStrategy::Type mWaitStrategy;
 };
 
 } // namespace lla
@@ -30,13 +30,13 @@
 ///
 /// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
 
-#ifndef O2_LLA_SRC_NAMEDMUTEX_H
-#define O2_LLA_SRC_NAMEDMUTEX_H
+#ifndef O2_LLA_INC_NAMEDMUTEX_H
+#define O2_LLA_INC_NAMEDMUTEX_H
 
 #include <boost/interprocess/sync/named_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 
-#include "InterprocessLockBase.h"
+#include "Lla/Locks/InterprocessLockBase.h"
 
 namespace bip = boost::interprocess;
 
@@ -45,14 +45,16 @@ namespace o2
 namespace lla
 {
 
-class NamedMutex : public InterprocessLockBase
+class NamedMutex final : public InterprocessLockBase
 {
  public:
+  /// The LockType selecting this implementation, which a BasicSession records for the card
+  static constexpr LockType::Type kLockType = LockType::NamedMutex;
+
   NamedMutex(const LockParameters& params);
   virtual ~NamedMutex() override;
-  virtual void lock() override;
-  virtual bool tryLock() override;
-  virtual bool timedLock(int timeOut) override;
+  virtual LockStatus::Type tryAcquire() override;
+  virtual LockStatus::Type timedAcquire(int timeOut) override;
   virtual void unlock() override;
 
  private:
@@ -63,4 +65,4 @@ class NamedMutex : public InterprocessLockBase
 } // namespace lla
 } // namespace o2
 
-#endif // O2_LLA_SRC_NAMEDMUTEX_H
+#endif // O2_LLA_INC_NAMEDMUTEX_H
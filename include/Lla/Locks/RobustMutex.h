@@ -0,0 +1,61 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file RobustMutex.h
+/// \brief Definition of the RobustMutex class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_ROBUSTMUTEX_H
+#define O2_LLA_INC_ROBUSTMUTEX_H
+
+#include <pthread.h>
+
+#include "Lla/Locks/InterprocessLockBase.h"
+#include "Lla/Locks/SharedMemory.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Lock on a robust, process-shared pthread mutex kept in a per-card shared memory segment
+///
+/// If the holder dies, the next locker gets EOWNERDEAD, marks the mutex consistent and takes
+/// over immediately. Like any pthread mutex, it belongs to the thread that locked it, and has to be
+/// unlocked by that thread.
+class RobustMutex final : public InterprocessLockBase
+{
+ public:
+  /// The LockType selecting this implementation, which a BasicSession records for the card
+  static constexpr LockType::Type kLockType = LockType::RobustMutex;
+
+  RobustMutex(const LockParameters& params);
+  virtual ~RobustMutex() override;
+  virtual LockStatus::Type tryAcquire() override;
+  virtual LockStatus::Type timedAcquire(int timeOut) override;
+
+  /// \throws o2::lla::LlaException if called from another thread than the one that locked it; the
+  /// lock is then still held
+  virtual void unlock() override;
+
+ private:
+  bool handleResult(int result);
+
+  SharedMemory<pthread_mutex_t> mShared;
+  bool mLocked = false;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_ROBUSTMUTEX_H
@@ -0,0 +1,110 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SharedMemory.h
+/// \brief Definition of the SharedMemory class template.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_SHAREDMEMORY_H
+#define O2_LLA_INC_SHAREDMEMORY_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+
+namespace bip = boost::interprocess;
+
+namespace o2
+{
+namespace lla
+{
+
+/// Maps an object of type T in a named POSIX shared memory segment
+///
+/// A freshly created segment is zero-filled, so T must be valid in its all-zero state, unless an
+/// initializer is given. The initializer runs exactly once over the lifetime of the segment, by
+/// whichever process gets there first; everyone else waits for it to complete.
+template <typename T>
+class SharedMemory
+{
+  static_assert(std::is_trivially_destructible<T>::value, "Shared memory objects are never destroyed");
+
+ public:
+  SharedMemory(const std::string& name, std::function<void(T&)> init = nullptr)
+  {
+    try {
+      bip::permissions permissions;
+      permissions.set_unrestricted();
+      mShm = bip::shared_memory_object(bip::open_or_create, name.c_str(), bip::read_write, permissions);
+
+      bip::offset_t size = 0;
+      if (!mShm.get_size(size) || size < (bip::offset_t)sizeof(Segment)) {
+        mShm.truncate(sizeof(Segment));
+      }
+      mRegion = bip::mapped_region(mShm, bip::read_write, 0, sizeof(Segment));
+    } catch (const bip::interprocess_exception& e) {
+      BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't map shared memory " + name + ": " + e.what()));
+    }
+
+    mSegment = static_cast<Segment*>(mRegion.get_address());
+
+    uint32_t state = Uninitialized;
+    if (mSegment->state.compare_exchange_strong(state, init ? Initializing : Ready)) {
+      if (init) {
+        init(mSegment->data);
+        mSegment->state.store(Ready);
+      }
+    } else {
+      const auto start = std::chrono::steady_clock::now();
+      while (mSegment->state.load() != Ready) {
+        if (std::chrono::steady_clock::now() - start > std::chrono::seconds(1)) {
+          BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Shared memory " + name + " was never initialized"));
+        }
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  T* get() { return &mSegment->data; }
+  T* operator->() { return get(); }
+  T& operator*() { return *get(); }
+
+ private:
+  enum State : uint32_t {
+    Uninitialized = 0,
+    Initializing,
+    Ready
+  };
+
+  struct Segment {
+    std::atomic<uint32_t> state;
+    T data;
+  };
+
+  bip::shared_memory_object mShm;
+  bip::mapped_region mRegion;
+  Segment* mSegment;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_SHAREDMEMORY_H
@@ -0,0 +1,75 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SocketLock.h
+/// \brief Definition of the SocketLock class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_SOCKETLOCK_H
+#define O2_LLA_INC_SOCKETLOCK_H
+
+#include <chrono>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Lla/Locks/InterprocessLockBase.h"
+
+//#define LOCK_TIMEOUT 5
+
+namespace o2
+{
+namespace lla
+{
+
+/// Lock based on binding an abstract unix domain socket, released automatically on process death
+///
+/// The holder also listens on a companion "wait" socket. Waiters connect to it and sleep in
+/// poll() until the holder closes it, on unlock or death, instead of retrying bind() in a loop.
+/// The holder accepts their connections to tell waiters still there from those that gave up.
+class SocketLock final : public InterprocessLockBase
+{
+ public:
+  /// The LockType selecting this implementation, which a BasicSession records for the card
+  static constexpr LockType::Type kLockType = LockType::SocketLock;
+
+  SocketLock(const LockParameters& params);
+  virtual ~SocketLock() override;
+  virtual LockStatus::Type tryAcquire() override;
+  virtual LockStatus::Type timedAcquire(int timeOut) override;
+  virtual bool waitForContention(int timeOut) override;
+  virtual void unlock() override;
+
+ private:
+  void makeAbstractAddress(struct sockaddr_un& address, const std::string& name);
+  void listenForWaiters(std::chrono::milliseconds patience);
+  bool hasWaiters();
+  bool waitForRelease(int timeOut);
+  void deferToWaiters(int timeOut);
+
+  int mSocketFd = -1;
+  int mWaitFd = -1;
+  std::vector<int> mWaiterFds; // Accepted connections of the waiters
+  std::string mSafeSocketLockName;
+  std::string mSafeWaitName;
+  bool mLocked = false;
+  bool mHadWaiters = false;
+  struct sockaddr_un mServerAddress;
+  struct sockaddr_un mWaitAddress;
+  socklen_t mAddressLength = sizeof(struct sockaddr_un);
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_SOCKETLOCK_H
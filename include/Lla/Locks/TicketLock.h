@@ -0,0 +1,72 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TicketLock.h
+/// \brief Definition of the TicketLock class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_TICKETLOCK_H
+#define O2_LLA_INC_TICKETLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "Lla/Locks/InterprocessLockBase.h"
+#include "Lla/Locks/SharedMemory.h"
+
+#define TICKET_LOCK_SLOTS 256 // Maximum number of simultaneous waiters, power of 2
+
+namespace o2
+{
+namespace lla
+{
+
+/// FIFO lock handing out tickets from a per-card shared memory queue
+///
+/// Every waiter sleeps on the futex of its own ticket slot; on unlock the holder grants the lock
+/// directly to the next ticket in arrival order, so there is no barging. Waiters that time out
+/// abandon their ticket, and waiters that died are detected through their pid; both are skipped.
+/// At most TICKET_LOCK_SLOTS tickets are out at a time; further waiters wait for the holder to
+/// move the queue on, or time out. The lock isn't released when its holder dies: it stays held
+/// until its shared memory segment is removed.
+class TicketLock final : public InterprocessLockBase
+{
+ public:
+  /// The LockType selecting this implementation, which a BasicSession records for the card
+  static constexpr LockType::Type kLockType = LockType::TicketLock;
+
+  TicketLock(const LockParameters& params);
+  virtual ~TicketLock() override;
+  virtual LockStatus::Type tryAcquire() override;
+  virtual LockStatus::Type timedAcquire(int timeOut) override;
+  virtual bool waitForContention(int timeOut) override;
+  virtual void unlock() override;
+
+ private:
+  struct TicketQueue {
+    std::atomic<uint32_t> next;  // The next ticket to hand out
+    std::atomic<uint32_t> owner; // The ticket the lock was last granted to
+    std::atomic<uint32_t> slots[TICKET_LOCK_SLOTS];
+    std::atomic<pid_t> pids[TICKET_LOCK_SLOTS];
+  };
+
+  SharedMemory<TicketQueue> mShared;
+  uint32_t mTicket = 0;
+  bool mLocked = false;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_TICKETLOCK_H
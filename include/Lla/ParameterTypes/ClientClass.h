@@ -0,0 +1,38 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file ClientClass.h
+/// \brief Definition of the ClientClass parameter.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_CLIENTCLASS_H
+#define O2_LLA_INC_CLIENTCLASS_H
+
+namespace o2
+{
+namespace lla
+{
+
+/// What kind of client a Session is for; hold time budgets are kept per class
+struct ClientClass {
+  enum Type {
+    Control,    ///< Detector control, e.g. FRED (default)
+    Monitoring, ///< Periodic readers of the card's status
+    Debug       ///< Interactive and debugging tools
+  };
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif
@@ -0,0 +1,37 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file LockGranularity.h
+/// \brief Definition of the LockGranularity parameter.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_LOCKGRANULARITY_H
+#define O2_LLA_INC_LOCKGRANULARITY_H
+
+namespace o2
+{
+namespace lla
+{
+
+/// What a Session gets exclusive access to
+struct LockGranularity {
+  enum Type {
+    Card,    ///< The whole card, both endpoints (default)
+    Endpoint ///< The endpoint of the CardId only; Sessions on the other endpoint run concurrently
+  };
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif
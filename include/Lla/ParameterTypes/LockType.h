@@ -27,7 +27,11 @@ struct LockType {
   enum Type {
     SocketLock,
     NamedMutex,
-    FileLock
+    FileLock,
+    FutexLock,
+    RobustMutex,
+    TicketLock,
+    Auto ///< The fastest of SocketLock and FileLock on this host, measured once and shared by all processes
   };
 };
 
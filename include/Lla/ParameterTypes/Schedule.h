@@ -0,0 +1,86 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Schedule.h
+/// \brief Definition of the Schedule parameter.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_SCHEDULE_H
+#define O2_LLA_INC_SCHEDULE_H
+
+#include <array>
+#include <string>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+#include "Lla/ParameterTypes/ClientClass.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Time-sliced arbitration schedule of a card
+///
+/// A frame of consecutive slots, each reserving the card for one client class, repeated from the
+/// boot of the host on. The slots are stored inline, so that copying a Schedule doesn't allocate.
+class Schedule
+{
+ public:
+  static constexpr int kMaxSlots = 8;
+
+  struct Slot {
+    ClientClass::Type clientClass;
+    int length; ///< In ms
+  };
+
+  /// Appends a slot to the frame
+  /// \param clientClass The client class the slot is for
+  /// \param length The length of the slot in ms
+  /// \return Reference to this object for chaining calls
+  /// \throws o2::lla::ParameterException if the length isn't positive, or the frame is full
+  Schedule& addSlot(ClientClass::Type clientClass, int length)
+  {
+    if (length <= 0) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Schedule slots have to be positive, was " + std::to_string(length)));
+    } else if (mSize == kMaxSlots) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Schedule has more than " + std::to_string(kMaxSlots) + " slots"));
+    }
+    mSlots[mSize++] = { clientClass, length };
+    return *this;
+  }
+
+  /// \return The number of slots
+  int size() const { return mSize; }
+
+  const Slot& operator[](int slot) const { return mSlots[slot]; }
+
+  /// \return The length of the frame in ms, the sum of the slots
+  int getFrameLength() const
+  {
+    int frame = 0;
+    for (int slot = 0; slot < mSize; ++slot) {
+      frame += mSlots[slot].length;
+    }
+    return frame;
+  }
+
+ private:
+  std::array<Slot, kMaxSlots> mSlots{};
+  int mSize = 0;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif
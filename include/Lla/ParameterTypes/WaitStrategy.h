@@ -0,0 +1,39 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file WaitStrategy.h
+/// \brief Definition of the WaitStrategy parameter.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_WAITSTRATEGY_H
+#define O2_LLA_INC_WAITSTRATEGY_H
+
+namespace o2
+{
+namespace lla
+{
+
+/// How timed acquisitions wait between attempts
+struct WaitStrategy {
+  enum Type {
+    Spin,      ///< Busy-wait; lowest latency, burns a core
+    SpinYield, ///< Busy-wait for a while, then yield the CPU between attempts
+    Backoff,   ///< Sleep between attempts, doubling the sleep each time, with jitter
+    Park       ///< Sleep in the kernel until the lock is released (default)
+  };
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif
@@ -22,14 +22,37 @@
 #include "Lla/InterprocessLockInterface.h"
 #include "Lla/LockParameters.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
-#include <mutex>
+#include <tuple>
+#include <vector>
 
 namespace o2
 {
 namespace lla
 {
 
+class CardArbiter;
+class CardQuota;
+class CardSchedule;
+class LockHierarchy;
+class Waiter;
+
+namespace detail
+{
+struct Handoff;
+struct Lease;
+struct WaitQueue;
+} // namespace detail
+
+/// Session with the lock implementation chosen at run time
+///
+/// Sessions of the same process for the same card go through a shared arbiter, which provides
+/// biased locking, reentrancy and handoffs between threads. For a Session without them, and
+/// without virtual dispatch or allocations on start and stop, see BasicSession.
 class Session
 {
 
@@ -43,6 +66,9 @@ class Session
 #endif
   /// Session constructor
   /// \param params The Session parameters
+  /// \throws o2::lla::ParameterException if processes alive use another LockType on the card, or
+  /// another Schedule, or another HoldQuota for the Session's ClientClass, or if the card's
+  /// Schedule has no slot for the Session's ClientClass
   Session(SessionParameters& params);
   Session(const Session& other);
   Session(Session&& other);
@@ -57,26 +83,143 @@ class Session
   /// Start a Session, trying until the timeOut has expired
   /// \param timeOut Timeout in ms after which to stop trying to start the session
   /// \return boolean; true if successful, otherwise false
+  /// \throws o2::lla::DeadlockException if the Sessions holding the card wait, directly or not,
+  /// for Sessions the calling thread holds
   bool timedStart(int timeOut);
 
+  /// Start whichever of the Sessions can start first, trying until the timeOut has expired
+  ///
+  /// The cards are waited for all at once; releases in any of them wake the caller up. Each Session
+  /// waits in the queue of its card meanwhile, ranked as in timedStart(). The wait isn't checked
+  /// for deadlocks.
+  /// \param sessions Stopped Sessions, e.g. one per card of the host
+  /// \param timeOut Timeout in ms after which to stop trying to start any of the sessions
+  /// \return The started Session, or nullptr if none could start
+  static Session* timedStartAny(std::vector<Session>& sessions, int timeOut);
+
   /// Stops a Session, releasing atomic access to the card's SC interface
+  ///
+  /// With a BiasGracePeriod set, the card stays locked until the grace period expires or
+  /// another process waits for it, unless a Session of this process starts in the meantime.
+  /// \throws o2::lla::LlaException if the card is locked by a RobustMutex or NamedMutex, which
+  /// belong to the thread that took them, and called from another thread; the Session stays started
   void stop();
 
+  /// Stops a started Session, handing the card over to the Session named recipient
+  ///
+  /// Until the recipient starts, or the timeOut expires, no other Session takes the card. The
+  /// recipient may be in another process, e.g. one that is restarting.
+  /// \param recipient The SessionName of the recipient
+  /// \param timeOut Time in ms the card is kept for the recipient
+  /// \throws o2::lla::LlaException if the Session isn't started, doesn't lock a whole card or
+  /// endpoint exclusively, or holds it through a lease, and in the cases of stop()
+  /// \throws o2::lla::ParameterException if the recipient name is too long
+  void handOff(const std::string& recipient, int timeOut);
+
+  /// Renews the lease of a started Session with a LeaseTime, for another LeaseTime
+  /// \return boolean; true if renewed, false if the lease was revoked, the Session then being stopped
+  bool renew();
+
+  /// Gets the generation of the lease of the Session, given out on start with a LeaseTime
+  ///
+  /// Generations increase with every lease on the card, or endpoint; a holder may use it to fence
+  /// off its actions once it lost the card.
+  /// \return The generation, or 0 if the Session never held a lease
+  uint32_t getLeaseGeneration() const;
+
+  /// Reports whether a waiter of higher priority asks the Session to yield its part of the card
+  ///
+  /// Cheap enough to be polled within the critical section: it only scans the queue of the card after
+  /// a waiter asked holders to yield, and otherwise reads a counter. A well-behaved holder then
+  /// stops the Session as soon as it can. See the PreemptTimeOut parameter.
+  /// \return boolean; true if the Session is started and asked to stop, false otherwise
+  bool isYieldRequested();
+
+  /// Gets the time left in the current slot of the Session's ClientClass, with a Schedule
+  ///
+  /// A holder is expected to stop before it runs out; it may be polled within the critical section.
+  /// \return The time left in ms, 0 outside of the slots of the class, or -1 without a Schedule
+  int getSlotTimeLeft() const;
+
   /// Reports on the state of the Session
   /// \return boolean; true if started, false otherwise
   bool isStarted();
 
  private:
+  friend class SessionGroup;
+
+  /// \return The card, endpoint, link and register group the Session locks, unset levels as -1
+  std::tuple<int, int, int, int> scope() const;
+
   void checkAndSetParameters();
-  void makeLockName();
+  void makeArbiters();
+  LockStatus::Type acquire(Waiter* waiter);
+  LockStatus::Type acquireLocks(Waiter* waiter);
+  std::atomic<uint32_t>* admit(uint32_t& word, std::chrono::nanoseconds& left);
+  void grantLease();
+  void endLease();
+  void enqueue();
+  void leaveQueue();
+  void setAside(bool aside);
+  LockStatus::Type acquireQueued(Waiter& waiter);
+  bool keptForThis();
+  bool outranked();
+  void requestYield();
+  std::chrono::nanoseconds preemption(int32_t holderPriority);
+  void chargeQuota();
+  LockStatus::Type acquireWaiting(Waiter& waiter);
+  LockStatus::Type acquireScheduled(Waiter& waiter);
+  LockStatus::Type acquireFrom(CardArbiter& arbiter, Waiter* waiter);
+  LockStatus::Type acquireCard(Waiter* waiter);
+  LockStatus::Type acquireEndpoint(Waiter* waiter);
+  LockStatus::Type acquireNode(Waiter* waiter);
+  void releaseScope(int gracePeriod);
+  void release(int gracePeriod);
 
   std::string mSessionName;
-  int mCardId;
   SessionParameters mParams;
   LockParameters mLockParams;
-  std::unique_ptr<InterprocessLockInterface> mLock;
-  bool mIsStarted = false;
-  std::mutex mMutex;
+  int mSerial;
+  int mEndpoint;
+  int mLinkId = -1;
+  int mRegisterGroup = -1;
+  AccessMode::Type mAccessMode = AccessMode::Exclusive;
+  LockGranularity::Type mGranularity = LockGranularity::Card;
+  std::shared_ptr<CardArbiter> mArbiter;                         // Of the card, or of the endpoint
+  std::shared_ptr<CardArbiter> mCardArbiter;                      // Endpoint granularity only
+  std::array<std::shared_ptr<CardArbiter>, 2> mEndpointArbiters; // Card granularity only
+  std::shared_ptr<const void> mLockTypeUse;                       // Registers the lock type on the card
+  std::shared_ptr<std::atomic<uint32_t>> mEndpointUsage;
+  bool mEndpointsHeld = false;
+  std::shared_ptr<LockHierarchy> mHierarchy; // Links and register groups
+  uint32_t mHierarchyTicket = 0;
+  std::shared_ptr<detail::Handoff> mHandoff;
+  std::shared_ptr<detail::Lease> mLease;
+  int mLeaseTime = 0;
+  uint32_t mLeaseGeneration = 0;
+  std::shared_ptr<detail::WaitQueue> mQueue;
+  int mPriority = 0;
+  int mPreemptTimeOut = -1;
+  int mQueueEntry = -1; // While waiting in timedStart() or timedStartAny()
+  int mGraphEntry = -1; // Hold recorded in the wait-for graph
+  std::atomic<uint64_t> mYieldScanned{ ~uint64_t(0) }; // Yield requests of the card when a scan last found none
+  std::shared_ptr<CardQuota> mQuota; // Of the card, applied to all Sessions of each class
+  std::shared_ptr<const void> mQuotaOwnership; // With a HoldQuota only
+  ClientClass::Type mClientClass = ClientClass::Control;
+  int mHoldQuota = 0; // Of the class as of the start, charged at the stop
+  std::chrono::steady_clock::time_point mStartTime;
+  std::shared_ptr<CardSchedule> mSchedule;          // Of the card, applied to all its Sessions
+  std::shared_ptr<const void> mScheduleOwnership; // With a Schedule only
+  int mBiasGracePeriod = 0;
+  bool mReentrant = false;
+
+  enum class State {
+    Stopped,
+    Starting,
+    Started,
+    Stopping
+  };
+  std::atomic<State> mState{ State::Stopped };
 };
 
 } // namespace lla
@@ -0,0 +1,90 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SessionGroup.h
+/// \brief Definition of the SessionGroup class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_INC_SESSIONGROUP_H
+#define O2_LLA_INC_SESSIONGROUP_H
+
+#include <memory>
+#include <vector>
+
+#include "Lla/Session.h"
+#include "Lla/SessionParameters.h"
+
+namespace o2
+{
+namespace lla
+{
+
+class Waiter;
+
+/// Sessions on several cards, started all or nothing
+///
+/// The Sessions are started in a canonical order (by card serial, then endpoint, link and register
+/// group), whatever the order of the parameters, so that groups overlapping in different orders
+/// don't deadlock. A start attempts the Sessions in one round, without waiting; only a busy Session
+/// is waited for, holding none of the Sessions that come after it, and all within one timeout. On
+/// failure, the Sessions already started are stopped. Sessions of a group on the same card have to
+/// lock disjoint parts of it, e.g. different links, or share them.
+///
+/// A SessionGroup may only be used by one thread at a time.
+class SessionGroup
+{
+ public:
+  /// SessionGroup constructor
+  /// \param params The parameters of the Sessions
+  /// \throws o2::lla::ParameterException if two Sessions lock the same part of a card, or parts
+  /// that exclude each other, e.g. the whole card and one of its links, which would wait for each
+  /// other; and if the parameters of a Session are rejected, as by the Session constructor
+  SessionGroup(const std::vector<SessionParameters>& params);
+  SessionGroup(const SessionGroup& other) = delete;
+  SessionGroup& operator=(const SessionGroup& other) = delete;
+  ~SessionGroup();
+
+  /// Start all the Sessions, without waiting
+  /// \return boolean; true if all started, otherwise false, with none started
+  bool start();
+
+  /// Start all the Sessions, trying until the timeOut has expired
+  /// \param timeOut Timeout in ms for the whole group
+  /// \return boolean; true if all started, otherwise false, with none started
+  bool timedStart(int timeOut);
+
+  /// Stops all the Sessions
+  void stop();
+
+  /// Reports on the state of the SessionGroup
+  /// \return boolean; true if started, false otherwise
+  bool isStarted() const;
+
+  /// \return The number of Sessions
+  std::size_t size() const;
+
+ private:
+  bool acquire(Waiter* waiter);
+  /// Starts the Sessions from first on, without waiting, up to the first busy one
+  /// \return The index of the first Session that couldn't start, or size()
+  std::size_t startFrom(std::size_t first);
+  void stopFrom(std::size_t first);
+
+  std::vector<std::unique_ptr<Session>> mSessions; // In canonical order
+  bool mStarted = false;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_INC_SESSIONGROUP_H
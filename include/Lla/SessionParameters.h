@@ -18,12 +18,20 @@
 #ifndef O2_LLA_INC_SESSIONPARAMETERS_H
 #define O2_LLA_INC_SESSIONPARAMETERS_H
 
+#include <string>
 #include <boost/optional.hpp>
 #include <boost/variant.hpp>
 
 #include <ReadoutCard/CardFinder.h>
 #include <ReadoutCard/Parameters.h>
 
+#include "Lla/ParameterTypes/AccessMode.h"
+#include "Lla/ParameterTypes/ClientClass.h"
+#include "Lla/ParameterTypes/LockGranularity.h"
+#include "Lla/ParameterTypes/LockType.h"
+#include "Lla/ParameterTypes/Schedule.h"
+#include "Lla/ParameterTypes/WaitStrategy.h"
+
 namespace roc = AliceO2::roc;
 
 namespace o2
@@ -39,9 +47,18 @@ class CardIdVisitor : public boost::static_visitor<int>
   int operator()(roc::Parameters::CardIdType cardId) const { return roc::findCard(cardId).serialId.getSerial(); };
 };
 
-struct ParametersPimpl;
+class SerialIdVisitor : public boost::static_visitor<roc::SerialId>
+{
+ public:
+  roc::SerialId operator()(const char* s) const { return roc::findCard(std::string(s)).serialId; };
+  roc::SerialId operator()(std::string s) const { return roc::findCard(s).serialId; };
+  roc::SerialId operator()(roc::Parameters::CardIdType cardId) const { return roc::findCard(cardId).serialId; };
+};
 
 /// Class holding Session Parameters
+///
+/// The parameters are stored inline, so that copying them doesn't allocate, as long as the
+/// SessionName and CardId strings are short.
 class SessionParameters
 {
  public:
@@ -60,6 +77,48 @@ class SessionParameters
   /// Type for the CardId
   using CardIdType = boost::variant<const char*, std::string, roc::Parameters::CardIdType>;
 
+  /// Type for the WaitStrategy
+  using WaitStrategyType = WaitStrategy::Type;
+
+  /// Type for the BiasGracePeriod, in ms
+  using BiasGracePeriodType = int;
+
+  /// Type for the Reentrant flag
+  using ReentrantType = bool;
+
+  /// Type for the LockType
+  using LockTypeType = LockType::Type;
+
+  /// Type for the LockGranularity
+  using LockGranularityType = LockGranularity::Type;
+
+  /// Type for the LinkId
+  using LinkIdType = int;
+
+  /// Type for the RegisterGroup
+  using RegisterGroupType = int;
+
+  /// Type for the AccessMode
+  using AccessModeType = AccessMode::Type;
+
+  /// Type for the LeaseTime, in ms
+  using LeaseTimeType = int;
+
+  /// Type for the Priority
+  using PriorityType = int;
+
+  /// Type for the PreemptTimeOut, in ms
+  using PreemptTimeOutType = int;
+
+  /// Type for the ClientClass
+  using ClientClassType = ClientClass::Type;
+
+  /// Type for the HoldQuota, in percent
+  using HoldQuotaType = int;
+
+  /// Type for the Schedule
+  using ScheduleType = Schedule;
+
   // Setters
 
   /// Sets the SessionName parameter
@@ -79,6 +138,184 @@ class SessionParameters
 
   auto setCardId(CardIdType value) -> SessionParameters&;
 
+  /// Sets the WaitStrategy parameter
+  ///
+  /// Optional parameter; how timedStart() waits for the card to become available.
+  /// Defaults to WaitStrategy::Park.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setWaitStrategy(WaitStrategyType value) -> SessionParameters&;
+
+  /// Sets the BiasGracePeriod parameter
+  ///
+  /// Optional parameter; enables biased locking. stop() then keeps the card locked for up to
+  /// this many ms, so that Sessions of this process can start() again without touching the lock.
+  /// Another process waiting in timedStart() revokes the bias early.
+  /// Ignored for the RobustMutex and the NamedMutex, which can't be released by another thread.
+  /// Defaults to 0, disabled.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setBiasGracePeriod(BiasGracePeriodType value) -> SessionParameters&;
+
+  /// Sets the Reentrant parameter
+  ///
+  /// Optional parameter; if true, starting the Session from a thread that already has a Session
+  /// for the same card started succeeds straight away, nesting inside it. The card is released
+  /// when the last of the nested Sessions stops.
+  /// Defaults to false; the Session fails to start, or times out, like for any other holder.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setReentrant(ReentrantType value) -> SessionParameters&;
+
+  /// Sets the LockType parameter
+  ///
+  /// Optional parameter; the lock implementation guarding the card. All the processes using a
+  /// card have to use the same one: the first Session on the card records its type in shared
+  /// memory, and Sessions of another type throw until no process uses the recorded one any more.
+  /// LockType::Auto picks the fastest one on this host, measuring
+  /// them on first use; the choice is shared by all processes until the next reboot. It only picks
+  /// among the locks released when their holder dies, and by any of its threads: the SocketLock
+  /// and the FileLock.
+  /// The O2_LLA_LOCK_TYPE environment variable, if set, overrides it; it takes one of
+  /// "socket-lock", "named-mutex", "file-lock", "futex-lock", "robust-mutex", "ticket-lock"
+  /// or "auto".
+  /// Defaults to LockType::SocketLock.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setLockType(LockTypeType value) -> SessionParameters&;
+
+  /// Sets the LockGranularity parameter
+  ///
+  /// Optional parameter; with LockGranularity::Endpoint, the Session only excludes Sessions on the
+  /// same endpoint of the card (e.g. "10234:0"), and Sessions with LockGranularity::Card.
+  /// Sessions on the two endpoints of a CRU then run concurrently. Once an Endpoint Session has
+  /// been used on a card, Card Sessions on it take the locks of both endpoints as well.
+  /// Defaults to LockGranularity::Card; the Session excludes all Sessions on the card.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setLockGranularity(LockGranularityType value) -> SessionParameters&;
+
+  /// Sets the LinkId parameter
+  ///
+  /// Optional parameter; the Session then only excludes Sessions on the same link of the endpoint
+  /// of the CardId, Sessions on its register groups, and Sessions on the whole endpoint or card.
+  /// Sessions on different links run concurrently. The LockGranularity is ignored.
+  /// Defaults to none; the Session covers the whole endpoint or card.
+  ///
+  /// \param value The value to set, from 0 to 23
+  /// \return Reference to this object for chaining calls
+  auto setLinkId(LinkIdType value) -> SessionParameters&;
+
+  /// Sets the RegisterGroup parameter
+  ///
+  /// Optional parameter; requires a LinkId. The Session then only excludes Sessions on the same
+  /// register group of the link, and Sessions on the whole link, endpoint or card.
+  /// Defaults to none; the Session covers the whole link.
+  ///
+  /// \param value The value to set, from 0 to 15
+  /// \return Reference to this object for chaining calls
+  auto setRegisterGroup(RegisterGroupType value) -> SessionParameters&;
+
+  /// Sets the AccessMode parameter
+  ///
+  /// Optional parameter; with AccessMode::Shared, for read-only access, the Session runs
+  /// concurrently with other Shared Sessions on the same card, endpoint, link or register group,
+  /// and only excludes Exclusive ones. Writers have the preference: an Exclusive Session waiting
+  /// in timedStart() keeps new Shared Sessions from starting. Shared Sessions ignore the
+  /// BiasGracePeriod and Reentrant parameters.
+  /// Defaults to AccessMode::Exclusive.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setAccessMode(AccessModeType value) -> SessionParameters&;
+
+  /// Sets the LeaseTime parameter
+  ///
+  /// Optional parameter; the Session then holds the card through a lease, instead of the lock,
+  /// which the holder has to renew() within this many ms. Once it expires, other Sessions waiting
+  /// for the card revoke it; renew() then fails, and the lease generation, given out anew on each
+  /// start, tells the former holder it lost the card. Only for Sessions locking a whole card or
+  /// endpoint exclusively; BiasGracePeriod and Reentrant are ignored. The lock of the card is free
+  /// during the lease, so only Sessions and BasicSessions, which check for it, are kept out.
+  /// Defaults to none; the Session holds the card until it stops.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setLeaseTime(LeaseTimeType value) -> SessionParameters&;
+
+  /// Sets the Priority parameter
+  ///
+  /// Optional parameter; waiters in timedStart() and timedStartAny() queue for the card, and the
+  /// card goes to the highest priority waiter first, e.g. FRED (DCS) ahead of debug tools; among
+  /// equal priorities, to the longest waiting one. Only waiters for parts of the card that exclude
+  /// each other come before one another, e.g. not those on different links. start() doesn't jump
+  /// the queue either. Waiters gain a priority level per second waited, so that lower priorities
+  /// don't starve.
+  /// Defaults to 0.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setPriority(PriorityType value) -> SessionParameters&;
+
+  /// Sets the PreemptTimeOut parameter
+  ///
+  /// Optional parameter; when a Session waits in timedStart() first in the queue, it asks the
+  /// holders of lower priority in its way to yield, as reported by their isYieldRequested().
+  /// If the holder has a LeaseTime, and hasn't yielded after this many ms, the lease is revoked.
+  /// Defaults to none; the holder is only asked.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setPreemptTimeOut(PreemptTimeOutType value) -> SessionParameters&;
+
+  /// Sets the ClientClass parameter
+  ///
+  /// Optional parameter; the class of client the Session is for, whose HoldQuota it is charged to.
+  /// Defaults to ClientClass::Control.
+  ///
+  /// \param value The value to set
+  /// \return Reference to this object for chaining calls
+  auto setClientClass(ClientClassType value) -> SessionParameters&;
+
+  /// Sets the HoldQuota parameter
+  ///
+  /// Optional parameter; caps the share of time Sessions of the ClientClass hold the card, e.g. 20
+  /// for debug tools, so that FRED always has headroom. The time held between start and stop is
+  /// charged to a token bucket of the class on the card, refilled at this percentage of real time,
+  /// holding up to this percentage of a second. Once a class is over budget, start() fails and
+  /// timedStart() waits for the bucket to refill first, failing straight away if the timeout
+  /// expires before then. The quota belongs to the card: it applies to all Sessions of the class on
+  /// the card, with or without one, as long as a Session that set it is alive; a Session setting a
+  /// different one for the class meanwhile is rejected.
+  /// Defaults to none; the hold time is capped only by the quota of the class on the card, if any.
+  ///
+  /// \param value The value to set, from 1 to 100
+  /// \return Reference to this object for chaining calls
+  auto setHoldQuota(HoldQuotaType value) -> SessionParameters&;
+
+  /// Sets the Schedule parameter
+  ///
+  /// Optional parameter; arbitrates the card by time slots, e.g. FRED (ClientClass::Control)
+  /// owning it for 80 ms of every 100 ms frame, and debug tools sharing the other 20 ms. The Session
+  /// then only starts within the slots of its ClientClass: start() fails outside of them, and
+  /// timedStart() waits for the next one, and for the card within it, keeping its place in the
+  /// queue from slot to slot. The holder is expected to stop by the end of its slot, as told by
+  /// getSlotTimeLeft(); it isn't revoked otherwise. Frames are aligned on the steady clock, the
+  /// same for all processes of the host. The Schedule is the card's: the Sessions setting it own
+  /// it, in shared memory, and it applies to all Sessions on the card, with or without one, as
+  /// well as BasicSessions, as ClientClass::Control. Sessions setting another one throw while an
+  /// owner is alive; it's cleared once all owners are gone.
+  /// Defaults to none; the card is arbitrated on demand, unless another Session set a Schedule.
+  ///
+  /// \param value The value to set, with at least one slot for the ClientClass
+  /// \return Reference to this object for chaining calls
+  auto setSchedule(ScheduleType value) -> SessionParameters&;
+
   // Optional Getters
 
   /// Gets the SessionName parameter
@@ -89,6 +326,62 @@ class SessionParameters
   /// \return The value wrapped in optional if it is present, or empty optional otherwise
   auto getCardId() const -> boost::optional<CardIdType>;
 
+  /// Gets the WaitStrategy parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getWaitStrategy() const -> boost::optional<WaitStrategyType>;
+
+  /// Gets the BiasGracePeriod parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getBiasGracePeriod() const -> boost::optional<BiasGracePeriodType>;
+
+  /// Gets the Reentrant parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getReentrant() const -> boost::optional<ReentrantType>;
+
+  /// Gets the LockType parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getLockType() const -> boost::optional<LockTypeType>;
+
+  /// Gets the LockGranularity parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getLockGranularity() const -> boost::optional<LockGranularityType>;
+
+  /// Gets the LinkId parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getLinkId() const -> boost::optional<LinkIdType>;
+
+  /// Gets the RegisterGroup parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getRegisterGroup() const -> boost::optional<RegisterGroupType>;
+
+  /// Gets the AccessMode parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getAccessMode() const -> boost::optional<AccessModeType>;
+
+  /// Gets the LeaseTime parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getLeaseTime() const -> boost::optional<LeaseTimeType>;
+
+  /// Gets the Priority parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getPriority() const -> boost::optional<PriorityType>;
+
+  /// Gets the PreemptTimeOut parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getPreemptTimeOut() const -> boost::optional<PreemptTimeOutType>;
+
+  /// Gets the ClientClass parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getClientClass() const -> boost::optional<ClientClassType>;
+
+  /// Gets the HoldQuota parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getHoldQuota() const -> boost::optional<HoldQuotaType>;
+
+  /// Gets the Schedule parameter
+  /// \return The value wrapped in optional if it is present, or empty optional otherwise
+  auto getSchedule() const -> boost::optional<ScheduleType>;
+
   // Throwing Getters
 
   /// Gets the SessionName parameter
@@ -101,6 +394,76 @@ class SessionParameters
   /// \throws o2::lla::ParameterException if not present
   auto getCardIdRequired() const -> CardIdType;
 
+  /// Gets the WaitStrategy parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getWaitStrategyRequired() const -> WaitStrategyType;
+
+  /// Gets the BiasGracePeriod parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getBiasGracePeriodRequired() const -> BiasGracePeriodType;
+
+  /// Gets the Reentrant parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getReentrantRequired() const -> ReentrantType;
+
+  /// Gets the LockType parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getLockTypeRequired() const -> LockTypeType;
+
+  /// Gets the LockGranularity parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getLockGranularityRequired() const -> LockGranularityType;
+
+  /// Gets the LinkId parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getLinkIdRequired() const -> LinkIdType;
+
+  /// Gets the RegisterGroup parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getRegisterGroupRequired() const -> RegisterGroupType;
+
+  /// Gets the AccessMode parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getAccessModeRequired() const -> AccessModeType;
+
+  /// Gets the LeaseTime parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getLeaseTimeRequired() const -> LeaseTimeType;
+
+  /// Gets the Priority parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getPriorityRequired() const -> PriorityType;
+
+  /// Gets the PreemptTimeOut parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getPreemptTimeOutRequired() const -> PreemptTimeOutType;
+
+  /// Gets the ClientClass parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getClientClassRequired() const -> ClientClassType;
+
+  /// Gets the HoldQuota parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getHoldQuotaRequired() const -> HoldQuotaType;
+
+  /// Gets the Schedule parameter
+  /// \return The value
+  /// \throws o2::lla::ParameterException if not present
+  auto getScheduleRequired() const -> ScheduleType;
+
   /// Convenience function to make a SessionParameters object
   /// \return The newly created SessionParameters object
   static SessionParameters makeParameters()
@@ -120,7 +483,22 @@ class SessionParameters
   }
 
  private:
-  std::unique_ptr<ParametersPimpl> mPimpl;
+  boost::optional<SessionNameType> mSessionName;
+  boost::optional<CardIdType> mCardId;
+  boost::optional<WaitStrategyType> mWaitStrategy;
+  boost::optional<BiasGracePeriodType> mBiasGracePeriod;
+  boost::optional<ReentrantType> mReentrant;
+  boost::optional<LockTypeType> mLockType;
+  boost::optional<LockGranularityType> mLockGranularity;
+  boost::optional<LinkIdType> mLinkId;
+  boost::optional<RegisterGroupType> mRegisterGroup;
+  boost::optional<AccessModeType> mAccessMode;
+  boost::optional<LeaseTimeType> mLeaseTime;
+  boost::optional<PriorityType> mPriority;
+  boost::optional<PreemptTimeOutType> mPreemptTimeOut;
+  boost::optional<ClientClassType> mClientClass;
+  boost::optional<HoldQuotaType> mHoldQuota;
+  boost::optional<ScheduleType> mSchedule;
 };
 
 } // namespace lla
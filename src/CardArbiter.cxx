@@ -0,0 +1,279 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardArbiter.cxx
+/// \brief Implementation of the CardArbiter class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unistd.h>
+
+#include "Lla/Exception.h"
+#include "Lla/Locks/Futex.h"
+#include "CardArbiter.h"
+#include "InterprocessLockFactory.h"
+
+namespace o2
+{
+namespace lla
+{
+
+namespace
+{
+// Consecutive handoffs between threads, before the interprocess lock is released for other processes
+constexpr int kMaxHandoffs = 8;
+
+// Upper bound for the releaser's waits, so that it notices state changes of its own process
+constexpr std::chrono::milliseconds kReleaserSlice(1);
+
+int millisecondsUntil(std::chrono::steady_clock::time_point deadline)
+{
+  auto left = deadline - std::chrono::steady_clock::now();
+  return std::max(0L, (long)std::chrono::duration_cast<std::chrono::milliseconds>(left + std::chrono::microseconds(999)).count());
+}
+} // anonymous namespace
+
+std::shared_ptr<CardArbiter> CardArbiter::getCardArbiter(const LockParameters& params)
+{
+  // Keyed by pid, lock name and lock type; looked up without copying the name
+  static std::mutex registryMutex;
+  static std::map<std::tuple<pid_t, std::string, int>, std::weak_ptr<CardArbiter>, std::less<>> registry;
+
+  if (!params.getLockNameView()) {
+    params.getLockNameRequired();
+  }
+
+  // A forked child must not inherit the arbiters of its parent, as they hold the parent's locks
+  const auto key = std::make_tuple(getpid(), params.getLockNameView(), int(params.getLockTypeRequired()));
+  std::lock_guard<std::mutex> lg(registryMutex);
+  auto it = registry.find(key);
+  if (it != registry.end()) {
+    if (auto arbiter = it->second.lock()) {
+      return arbiter;
+    }
+  }
+
+  auto arbiter = std::make_shared<CardArbiter>(params);
+  registry[key] = arbiter;
+  return arbiter;
+}
+
+CardArbiter::CardArbiter(const LockParameters& params)
+  : mLock(InterprocessLockFactory::getInterprocessLock(params)),
+    mReleases(params.getLockNameRequired() + "_releases"),
+    mThreadAffine(params.getLockTypeRequired() == LockType::Type::RobustMutex ||
+                  params.getLockTypeRequired() == LockType::Type::NamedMutex)
+{
+}
+
+CardArbiter::~CardArbiter()
+{
+  if (mReleaser.joinable()) {
+    {
+      std::lock_guard<std::mutex> lg(mMutex);
+      mExitReleaser = true;
+    }
+    mBiasCondition.notify_one();
+    mReleaser.join();
+  }
+
+  if (mHeld) {
+    try {
+      unlockInterprocess();
+    } catch (const LlaException&) {
+      // Destroyed by another thread than the holder; the lock goes when the holder exits
+    }
+  }
+}
+
+LockStatus::Type CardArbiter::tryAcquire(bool reentrant)
+{
+  std::unique_lock<std::mutex> ul(mMutex);
+  if (nest(reentrant)) {
+    return LockStatus::Acquired;
+  } else if (mOwned || mRevoking) {
+    return LockStatus::Busy;
+  }
+
+  return own(ul, boost::none);
+}
+
+LockStatus::Type CardArbiter::timedAcquire(int timeOut, bool reentrant)
+{
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+  std::unique_lock<std::mutex> ul(mMutex);
+  if (nest(reentrant)) {
+    return LockStatus::Acquired;
+  }
+
+  mWaiters++;
+  bool free = mCondition.wait_until(ul, deadline, [&]() { return !mOwned && !mRevoking; });
+  mWaiters--;
+  if (!free) {
+    return LockStatus::TimedOut;
+  }
+
+  return own(ul, millisecondsUntil(deadline));
+}
+
+void CardArbiter::release(int gracePeriod)
+{
+  std::unique_lock<std::mutex> ul(mMutex);
+  if (!mOwned) {
+    return;
+  } else if (mThreadAffine && mOwner != std::this_thread::get_id()) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("The lock of the card can only be released by the thread that took it"));
+  } else if (--mDepth > 0) {
+    return;
+  }
+  mOwned = false;
+
+  // Hand the interprocess lock over to a queued thread
+  if (mWaiters > 0 && !mThreadAffine && mHandoffs < kMaxHandoffs) {
+    mHandoffs++;
+    mCondition.notify_one();
+    return;
+  }
+  mHandoffs = 0;
+
+  if (gracePeriod > 0 && !mThreadAffine && !mReleaser.joinable()) {
+    mReleaser = std::thread(&CardArbiter::releaseBias, this);
+  }
+
+  if (mReleaser.joinable()) {
+    // Only the releaser unlocks from now on, as it may be waiting on the lock; if threads are
+    // queued, they've had their handoffs, so it releases right away and they queue behind it
+    mBiased = true;
+    mRevoking = mWaiters > 0;
+    mBiasDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(mRevoking ? 0 : gracePeriod);
+    mBiasCondition.notify_one();
+  } else {
+    try {
+      unlockInterprocess();
+    } catch (...) {
+      // Still held; the card stays owned, for the release to be tried again
+      mOwned = true;
+      mDepth = 1;
+      throw;
+    }
+    mCondition.notify_one();
+  }
+}
+
+CardArbiter::Releases& CardArbiter::releases()
+{
+  return *mReleases;
+}
+
+bool CardArbiter::isOwner()
+{
+  std::lock_guard<std::mutex> lg(mMutex);
+  return mOwned && mOwner == std::this_thread::get_id();
+}
+
+bool CardArbiter::isReleasable()
+{
+  std::lock_guard<std::mutex> lg(mMutex);
+  return !mThreadAffine || !mOwned || mOwner == std::this_thread::get_id();
+}
+
+/// Nests a reentrant acquisition inside the ownership of the calling thread, if it owns the card
+bool CardArbiter::nest(bool reentrant)
+{
+  if (reentrant && mOwned && mOwner == std::this_thread::get_id()) {
+    mDepth++;
+    return true;
+  }
+  return false;
+}
+
+/// Makes the calling thread the owner, and takes the interprocess lock unless the process holds it
+/// \param timeOut Time in ms to wait for the interprocess lock, or none for a single attempt
+LockStatus::Type CardArbiter::own(std::unique_lock<std::mutex>& ul, boost::optional<int> timeOut)
+{
+  mOwned = true;
+  mOwner = std::this_thread::get_id();
+  mDepth = 1;
+  if (mHeld) { // Handed over, or still biased towards this process
+    mBiased = false;
+    return LockStatus::Acquired;
+  }
+
+  // Only the owner touches the interprocess lock, so the mutex can be let go in the meantime
+  ul.unlock();
+  LockStatus::Type status;
+  try {
+    status = timeOut ? mLock->timedAcquire(*timeOut) : mLock->tryAcquire();
+  } catch (...) {
+    ul.lock();
+    mOwned = false;
+    mCondition.notify_one();
+    throw;
+  }
+  ul.lock();
+
+  if (status == LockStatus::Acquired) {
+    mHeld = true;
+  } else {
+    mOwned = false;
+    mCondition.notify_one();
+  }
+  return status;
+}
+
+/// Body of the releaser thread; releases a biased lock when the grace period expires, or as
+/// soon as another process waits for it
+void CardArbiter::releaseBias()
+{
+  std::unique_lock<std::mutex> ul(mMutex);
+  bool contended = false;
+
+  while (true) {
+    mBiasCondition.wait(ul, [&]() { return mBiased || mExitReleaser; });
+    if (mExitReleaser) {
+      return;
+    }
+
+    auto left = mBiasDeadline - std::chrono::steady_clock::now();
+    if (contended || left <= std::chrono::nanoseconds(0)) {
+      unlockInterprocess();
+      mBiased = false;
+      mRevoking = false;
+      contended = false;
+      mCondition.notify_one();
+      continue;
+    }
+
+    // The lock stays held while we wait unlocked; only this thread releases it
+    auto timeOut = std::chrono::duration_cast<std::chrono::milliseconds>(std::min<std::chrono::nanoseconds>(left, kReleaserSlice) + std::chrono::microseconds(999));
+    ul.unlock();
+    contended = mLock->waitForContention(timeOut.count()) || mReleases->waiters.load() > 0;
+    ul.lock();
+  }
+}
+
+void CardArbiter::unlockInterprocess()
+{
+  mLock->unlock();
+  mHeld = false;
+  mReleases->generation.fetch_add(1);
+  if (mReleases->waiters.load() > 0) {
+    futex::wakeAll(&mReleases->generation);
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,113 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardArbiter.h
+/// \brief Definition of the CardArbiter class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_CARDARBITER_H
+#define O2_LLA_SRC_CARDARBITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <boost/optional.hpp>
+
+#include "Lla/InterprocessLockInterface.h"
+#include "Lla/LockParameters.h"
+#include "Lla/Locks/SharedMemory.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Process-wide arbiter for one card, shared by all the Sessions of the process using the same lock
+///
+/// Threads queue on a mutex and condition variable; only the thread owning the arbiter touches the
+/// interprocess lock. When other threads are queued, the interprocess lock is handed over to them
+/// without being released, up to a limit, so that other processes get their turn. Releases may
+/// also be deferred for a grace period (biased locking), during which the process keeps the lock
+/// unless another process is seen waiting for it.
+class CardArbiter
+{
+ public:
+  /// Announces the releases of the interprocess lock, in shared memory, to processes waiting on
+  /// several cards at once
+  struct Releases {
+    std::atomic<uint32_t> generation; // Futex word, bumped on every release
+    std::atomic<uint32_t> waiters;    // Processes sleeping on the generation
+  };
+
+  /// Gets the arbiter for the lock described by the parameters, creating it if needed
+  /// The interprocess lock is created with the parameters of the first caller
+  static std::shared_ptr<CardArbiter> getCardArbiter(const LockParameters& params);
+
+  CardArbiter(const LockParameters& params);
+  ~CardArbiter();
+
+  /// \param reentrant If the calling thread already owns the card, nest inside its ownership
+  LockStatus::Type tryAcquire(bool reentrant = false);
+
+  /// \param reentrant If the calling thread already owns the card, nest inside its ownership
+  LockStatus::Type timedAcquire(int timeOut, bool reentrant = false);
+
+  /// Releases the card, once per acquisition; when the outermost acquisition is released, the
+  /// interprocess lock is kept for queued threads, or for the grace period
+  /// \param gracePeriod Time in ms to keep the interprocess lock for, if nobody else wants it
+  /// \throws o2::lla::LlaException if the lock is bound to the owning thread, and called from
+  /// another one, or if unlocking fails; the card stays owned either way
+  void release(int gracePeriod = 0);
+
+  Releases& releases();
+
+  /// \return true if the calling thread owns the card
+  bool isOwner();
+
+  /// \return true unless the lock is bound to the thread owning the card, and that's another one
+  bool isReleasable();
+
+ private:
+  bool nest(bool reentrant);
+  LockStatus::Type own(std::unique_lock<std::mutex>& ul, boost::optional<int> timeOut);
+  void releaseBias();
+  void unlockInterprocess();
+
+  std::unique_ptr<InterprocessLockInterface> mLock;
+  SharedMemory<Releases> mReleases;
+  bool mThreadAffine; // The interprocess lock has to be released by the thread that took it (mutexes)
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mOwned = false; // A thread of this process owns the card
+  std::thread::id mOwner;
+  int mDepth = 0; // Nested acquisitions by the owner
+  bool mHeld = false;  // This process holds the interprocess lock
+  int mWaiters = 0;
+  int mHandoffs = 0;
+
+  // Biased locking; the releaser thread holds on to the lock when nobody owns it
+  bool mBiased = false;
+  bool mRevoking = false; // The releaser has to release the lock before it's owned again
+  bool mExitReleaser = false;
+  std::chrono::steady_clock::time_point mBiasDeadline;
+  std::condition_variable mBiasCondition;
+  std::thread mReleaser;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_CARDARBITER_H
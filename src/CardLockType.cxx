@@ -0,0 +1,140 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardLockType.cxx
+/// \brief Implementation of the CardLockType class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <string>
+#include <unistd.h>
+#include <boost/throw_exception.hpp>
+
+#include "CardLockType.h"
+#include "Lla/Exception.h"
+#include "LockTypeSelector.h"
+
+namespace o2
+{
+namespace lla
+{
+
+constexpr int CardLockType::kMaxUsers;
+
+namespace
+{
+bool isAlive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+} // anonymous namespace
+
+CardLockType::CardLockType(int serial)
+  : mSerial(serial),
+    mShared("_CRU_" + std::to_string(serial) + "_lla_lock_type", initTable)
+{
+}
+
+void CardLockType::initTable(Table& table)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&table.mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+std::shared_ptr<const void> CardLockType::use(LockType::Type lockType)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  const pid_t pid = getpid();
+  if (auto use = mUse.lock()) {
+    if (mPid == pid && mLockType == lockType) {
+      return use;
+    } else if (mPid == pid) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Card " + std::to_string(mSerial) + " is already locked with " + LockTypeSelector::toString(mLockType) + " by this process, can't use " + LockTypeSelector::toString(lockType)));
+    }
+  }
+
+  // Registered, unless a previous use was released while another thread was taking this one
+  auto& table = *mShared;
+  lockTable();
+  int free = -1;
+  bool registered = false;
+  bool othersUse = false;
+  for (int i = 0; i < kMaxUsers; ++i) {
+    if (table.users[i] != 0 && table.users[i] != pid && !isAlive(table.users[i])) {
+      table.users[i] = 0;
+    }
+    if (table.users[i] == 0) {
+      free = free < 0 ? i : free;
+    } else if (table.users[i] == pid) {
+      registered = true;
+    } else {
+      othersUse = true;
+    }
+  }
+
+  const int32_t recorded = table.lockType - 1;
+  if (othersUse && recorded >= 0 && recorded != lockType) {
+    pthread_mutex_unlock(&table.mutex);
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Card " + std::to_string(mSerial) + " is locked with " + LockTypeSelector::toString(static_cast<LockType::Type>(recorded)) + " by other processes, can't use " + LockTypeSelector::toString(lockType)));
+  } else if (!registered && free < 0) {
+    pthread_mutex_unlock(&table.mutex);
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Too many processes use card " + std::to_string(mSerial)));
+  }
+  table.lockType = 1 + lockType;
+  if (!registered) {
+    table.users[free] = pid;
+  }
+  pthread_mutex_unlock(&table.mutex);
+
+  std::shared_ptr<const void> use(this, [this](const void*) { unregister(); });
+  mUse = use;
+  mLockType = lockType;
+  mPid = pid;
+  return use;
+}
+
+void CardLockType::unregister()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  // A use taken since by another thread, or a forked child, keeps the pid registered
+  if (!mUse.expired() || mPid != getpid()) {
+    return;
+  }
+  auto& table = *mShared;
+  lockTable();
+  for (int i = 0; i < kMaxUsers; ++i) {
+    if (table.users[i] == mPid) {
+      table.users[i] = 0;
+    }
+  }
+  pthread_mutex_unlock(&table.mutex);
+}
+
+void CardLockType::lockTable()
+{
+  int result = pthread_mutex_lock(&mShared->mutex);
+  if (result == EOWNERDEAD) {
+    // The record and the pids are single words, so the table is consistent as is
+    pthread_mutex_consistent(&mShared->mutex);
+  } else if (result != 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't lock the lock type record of card " + std::to_string(mSerial) + ": " + std::string(strerror(result))));
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,76 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardLockType.h
+/// \brief Definition of the CardLockType class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_CARDLOCKTYPE_H
+#define O2_LLA_SRC_CARDLOCKTYPE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "Lla/Locks/SharedMemory.h"
+#include "Lla/ParameterTypes/LockType.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// The lock type in use on a card, shared by its processes
+///
+/// Locks of different types don't exclude each other, so the first process to use the card
+/// records its type, and the others have to use the same one, until all of its users are gone.
+/// The record, and the pids of its users, live in shared memory, guarded by a robust mutex;
+/// users that died are dropped.
+class CardLockType
+{
+ public:
+  CardLockType(int serial);
+
+  /// Records the lock type as in use by the calling process
+  /// \return Keeps the process registered as a user; releasing the last one unregisters it
+  /// \throws o2::lla::ParameterException if processes alive, or the caller, use another type on the card
+  std::shared_ptr<const void> use(LockType::Type lockType);
+
+ private:
+  static constexpr int kMaxUsers = 64;
+
+  struct Table {
+    pthread_mutex_t mutex;
+    int32_t lockType; // 1 + the type in use, 0 if none was recorded
+    int32_t users[kMaxUsers]; // 0 for a free slot
+  };
+
+  static void initTable(Table& table);
+  void lockTable();
+  void unregister();
+
+  int mSerial;
+  SharedMemory<Table> mShared;
+
+  // Registration of the calling process
+  std::mutex mMutex;
+  std::weak_ptr<const void> mUse;
+  LockType::Type mLockType = LockType::Auto;
+  pid_t mPid = 0;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_CARDLOCKTYPE_H
@@ -0,0 +1,171 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardQuota.cxx
+/// \brief Implementation of the CardQuota class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <string>
+#include <unistd.h>
+#include <boost/throw_exception.hpp>
+
+#include "CardQuota.h"
+#include "Lla/Exception.h"
+
+namespace o2
+{
+namespace lla
+{
+
+constexpr std::chrono::seconds CardQuota::kWindow;
+constexpr int CardQuota::kClientClasses;
+constexpr int CardQuota::kMaxOwners;
+
+namespace
+{
+bool isAlive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+} // anonymous namespace
+
+CardQuota::CardQuota(int serial)
+  : mSerial(serial),
+    mShared("_CRU_" + std::to_string(serial) + "_lla_quota", initTable)
+{
+}
+
+void CardQuota::initTable(Table& table)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&table.mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+std::shared_ptr<const void> CardQuota::set(ClientClass::Type clientClass, int holdQuota)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  const pid_t pid = getpid();
+  if (auto ownership = mOwnership[clientClass].lock()) {
+    if (mPid[clientClass] == pid && mHoldQuota[clientClass] == holdQuota) {
+      return ownership;
+    } else if (mPid[clientClass] == pid) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("The ClientClass already has a HoldQuota of " + std::to_string(mHoldQuota[clientClass]) + "% on card " + std::to_string(mSerial) + ", set by this process"));
+    }
+  }
+
+  // An owner, unless a previous ownership was released while another thread was taking this one
+  auto& table = *mShared;
+  auto& owners = table.owners[clientClass];
+  lockTable();
+  int free = -1;
+  bool owner = false;
+  bool othersOwn = false;
+  for (int i = 0; i < kMaxOwners; ++i) {
+    if (owners[i] != 0 && owners[i] != pid && !isAlive(owners[i])) {
+      owners[i] = 0;
+    }
+    if (owners[i] == 0) {
+      free = free < 0 ? i : free;
+    } else if (owners[i] == pid) {
+      owner = true;
+    } else {
+      othersOwn = true;
+    }
+  }
+
+  const int recorded = table.holdQuota[clientClass].load();
+  if (othersOwn && recorded != holdQuota) {
+    pthread_mutex_unlock(&table.mutex);
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("The ClientClass already has a HoldQuota of " + std::to_string(recorded) + "% on card " + std::to_string(mSerial) + ", set by other processes"));
+  } else if (!owner && free < 0) {
+    pthread_mutex_unlock(&table.mutex);
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Too many processes set HoldQuotas on card " + std::to_string(mSerial)));
+  }
+  table.holdQuota[clientClass].store(holdQuota);
+  if (!owner) {
+    owners[free] = pid;
+  }
+  pthread_mutex_unlock(&table.mutex);
+
+  std::shared_ptr<const void> ownership(this, [this, clientClass](const void*) { unregister(clientClass); });
+  mOwnership[clientClass] = ownership;
+  mHoldQuota[clientClass] = holdQuota;
+  mPid[clientClass] = pid;
+  return ownership;
+}
+
+int CardQuota::get(ClientClass::Type clientClass)
+{
+  return mShared->holdQuota[clientClass].load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds CardQuota::delay(ClientClass::Type clientClass)
+{
+  auto fullAt = std::chrono::nanoseconds(mShared->fullAt[clientClass].load());
+  return fullAt - kWindow - std::chrono::steady_clock::now().time_since_epoch();
+}
+
+void CardQuota::charge(ClientClass::Type clientClass, int holdQuota, std::chrono::nanoseconds held)
+{
+  const int64_t cost = held.count() * 100 / holdQuota;
+  const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  auto& fullAt = mShared->fullAt[clientClass];
+  int64_t previous = fullAt.load();
+  while (!fullAt.compare_exchange_weak(previous, std::max(previous, now) + cost)) {
+  }
+}
+
+void CardQuota::unregister(ClientClass::Type clientClass)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  // An ownership taken since by another thread, or a forked child, keeps the process an owner
+  if (!mOwnership[clientClass].expired() || mPid[clientClass] != getpid()) {
+    return;
+  }
+  auto& table = *mShared;
+  auto& owners = table.owners[clientClass];
+  lockTable();
+  bool othersOwn = false;
+  for (int i = 0; i < kMaxOwners; ++i) {
+    if (owners[i] == mPid[clientClass]) {
+      owners[i] = 0;
+    } else if (owners[i] != 0 && isAlive(owners[i])) {
+      othersOwn = true;
+    }
+  }
+  if (!othersOwn) {
+    table.holdQuota[clientClass].store(0);
+  }
+  pthread_mutex_unlock(&table.mutex);
+}
+
+void CardQuota::lockTable()
+{
+  int result = pthread_mutex_lock(&mShared->mutex);
+  if (result == EOWNERDEAD) {
+    // The quotas and the owners are single words, so the table is consistent as is
+    pthread_mutex_consistent(&mShared->mutex);
+  } else if (result != 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't lock the HoldQuotas of card " + std::to_string(mSerial) + ": " + std::string(strerror(result))));
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,96 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardQuota.h
+/// \brief Definition of the CardQuota class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_CARDQUOTA_H
+#define O2_LLA_SRC_CARDQUOTA_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "Lla/Locks/SharedMemory.h"
+#include "Lla/ParameterTypes/ClientClass.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Hold time budgets of the client classes on a card, applied to all the Sessions of each class
+///
+/// The HoldQuota of a class is set by the Sessions of the class given one, its owners; others with
+/// a different one are rejected while an owner is alive. It's cleared once the last owner releases
+/// it; one left by owners that died holds until another one is set.
+/// Each token bucket is kept as a single time, at which it would be full again: hold time charged
+/// to it pushes it back by 100 / HoldQuota times as much, and it refills in real time. A class is
+/// over budget while the bucket is due to be full more than kWindow from now.
+/// All of it lives in shared memory; the quotas and their owners are written under a robust mutex.
+class CardQuota
+{
+ public:
+  /// A class may hold the card for its HoldQuota of this window in one burst
+  static constexpr std::chrono::seconds kWindow{ 1 };
+
+  CardQuota(int serial);
+
+  /// Sets the HoldQuota of the class on the card, owned by the calling process
+  /// \return Keeps the process an owner; releasing the last one of all owners clears the quota
+  /// \throws o2::lla::ParameterException if owners alive, or the caller, set another quota
+  std::shared_ptr<const void> set(ClientClass::Type clientClass, int holdQuota);
+
+  /// \return The HoldQuota of the class, in %, or 0 without one
+  int get(ClientClass::Type clientClass);
+
+  /// \return Time until the class is within its HoldQuota again, not positive if it is
+  std::chrono::nanoseconds delay(ClientClass::Type clientClass);
+
+  /// Charges time held to the class
+  /// \param holdQuota The HoldQuota of the class when the time started
+  void charge(ClientClass::Type clientClass, int holdQuota, std::chrono::nanoseconds held);
+
+ private:
+  static constexpr int kClientClasses = ClientClass::Debug + 1;
+  static constexpr int kMaxOwners = 64;
+
+  struct Table {
+    pthread_mutex_t mutex;
+    std::atomic<int32_t> holdQuota[kClientClasses]; // 0 without one
+    int32_t owners[kClientClasses][kMaxOwners]; // 0 for a free slot
+    std::atomic<int64_t> fullAt[kClientClasses]; // In ns of the steady clock
+  };
+
+  static void initTable(Table& table);
+  void lockTable();
+  void unregister(ClientClass::Type clientClass);
+
+  int mSerial;
+  SharedMemory<Table> mShared;
+
+  // Ownership of the calling process, per class
+  std::mutex mMutex;
+  std::weak_ptr<const void> mOwnership[kClientClasses];
+  int mHoldQuota[kClientClasses] = {};
+  pid_t mPid[kClientClasses] = {};
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_CARDQUOTA_H
@@ -0,0 +1,186 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardSchedule.cxx
+/// \brief Implementation of the CardSchedule class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <string>
+#include <unistd.h>
+#include <boost/throw_exception.hpp>
+
+#include "CardSchedule.h"
+#include "Lla/Exception.h"
+
+namespace o2
+{
+namespace lla
+{
+
+constexpr int CardSchedule::kMaxOwners;
+
+namespace
+{
+bool isAlive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+bool isSame(const Schedule& a, const Schedule& b)
+{
+  bool same = a.size() == b.size();
+  for (int slot = 0; same && slot < a.size(); ++slot) {
+    same = a[slot].clientClass == b[slot].clientClass && a[slot].length == b[slot].length;
+  }
+  return same;
+}
+} // anonymous namespace
+
+CardSchedule::CardSchedule(int serial)
+  : mSerial(serial),
+    mShared("_CRU_" + std::to_string(serial) + "_lla_schedule", initTable)
+{
+}
+
+void CardSchedule::initTable(Table& table)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&table.mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+std::shared_ptr<const void> CardSchedule::set(const Schedule& schedule)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  const pid_t pid = getpid();
+  if (auto ownership = mOwnership.lock()) {
+    if (mPid == pid && isSame(mSchedule, schedule)) {
+      return ownership;
+    } else if (mPid == pid) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Card " + std::to_string(mSerial) + " already has another Schedule, set by this process"));
+    }
+  }
+
+  // An owner, unless a previous ownership was released while another thread was taking this one
+  auto& table = *mShared;
+  lockTable();
+  int free = -1;
+  bool owner = false;
+  bool othersOwn = false;
+  for (int i = 0; i < kMaxOwners; ++i) {
+    if (table.owners[i] != 0 && table.owners[i] != pid && !isAlive(table.owners[i])) {
+      table.owners[i] = 0;
+    }
+    if (table.owners[i] == 0) {
+      free = free < 0 ? i : free;
+    } else if (table.owners[i] == pid) {
+      owner = true;
+    } else {
+      othersOwn = true;
+    }
+  }
+
+  if (othersOwn && !isSame(table.schedule, schedule)) {
+    pthread_mutex_unlock(&table.mutex);
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Card " + std::to_string(mSerial) + " already has another Schedule, set by other processes"));
+  } else if (!owner && free < 0) {
+    pthread_mutex_unlock(&table.mutex);
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Too many processes set the Schedule of card " + std::to_string(mSerial)));
+  }
+  if (!isSame(table.schedule, schedule)) {
+    write(schedule);
+  }
+  if (!owner) {
+    table.owners[free] = pid;
+  }
+  pthread_mutex_unlock(&table.mutex);
+
+  std::shared_ptr<const void> ownership(this, [this](const void*) { unregister(); });
+  mOwnership = ownership;
+  mSchedule = schedule;
+  mPid = pid;
+  return ownership;
+}
+
+Schedule CardSchedule::get()
+{
+  auto& table = *mShared;
+  while (true) {
+    uint32_t sequence = table.sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      continue;
+    }
+    Schedule schedule;
+    std::memcpy(static_cast<void*>(&schedule), &table.schedule, sizeof(schedule));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (table.sequence.load(std::memory_order_relaxed) == sequence) {
+      return schedule;
+    }
+  }
+}
+
+/// Holding the table, writes the Schedule for the readers
+void CardSchedule::write(const Schedule& schedule)
+{
+  auto& table = *mShared;
+  table.sequence.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(static_cast<void*>(&table.schedule), &schedule, sizeof(schedule));
+  table.sequence.fetch_add(1, std::memory_order_release);
+}
+
+void CardSchedule::unregister()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  // An ownership taken since by another thread, or a forked child, keeps the process an owner
+  if (!mOwnership.expired() || mPid != getpid()) {
+    return;
+  }
+  auto& table = *mShared;
+  lockTable();
+  bool othersOwn = false;
+  for (int i = 0; i < kMaxOwners; ++i) {
+    if (table.owners[i] == mPid) {
+      table.owners[i] = 0;
+    } else if (table.owners[i] != 0 && isAlive(table.owners[i])) {
+      othersOwn = true;
+    }
+  }
+  if (!othersOwn) {
+    write(Schedule());
+  }
+  pthread_mutex_unlock(&table.mutex);
+}
+
+void CardSchedule::lockTable()
+{
+  int result = pthread_mutex_lock(&mShared->mutex);
+  if (result == EOWNERDEAD) {
+    // A Schedule written halfway leaves the sequence odd; clear it
+    if (mShared->sequence.load() & 1) {
+      mShared->sequence.fetch_add(1);
+      write(Schedule());
+    }
+    pthread_mutex_consistent(&mShared->mutex);
+  } else if (result != 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't lock the Schedule of card " + std::to_string(mSerial) + ": " + std::string(strerror(result))));
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,82 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CardSchedule.h
+/// \brief Definition of the CardSchedule class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_CARDSCHEDULE_H
+#define O2_LLA_SRC_CARDSCHEDULE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "Lla/Locks/SharedMemory.h"
+#include "Lla/ParameterTypes/Schedule.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// The Schedule of a card, applied to all the Sessions on it
+///
+/// Set by the Sessions given a Schedule, its owners; others with a different one are rejected
+/// while an owner is alive. The Schedule is cleared once the last owner releases it; one left by
+/// owners that died holds until another one is set. It lives in shared memory, written under a
+/// robust mutex, and read without it through a sequence counter.
+class CardSchedule
+{
+ public:
+  CardSchedule(int serial);
+
+  /// Sets the Schedule of the card, owned by the calling process
+  /// \return Keeps the process an owner; releasing the last one of all owners clears the Schedule
+  /// \throws o2::lla::ParameterException if owners alive, or the caller, set another Schedule
+  std::shared_ptr<const void> set(const Schedule& schedule);
+
+  /// \return The Schedule of the card, empty without one
+  Schedule get();
+
+ private:
+  static constexpr int kMaxOwners = 64;
+
+  struct Table {
+    pthread_mutex_t mutex;
+    std::atomic<uint32_t> sequence; // Odd while the Schedule is written
+    Schedule schedule;
+    int32_t owners[kMaxOwners]; // 0 for a free slot
+  };
+
+  static void initTable(Table& table);
+  void lockTable();
+  void write(const Schedule& schedule);
+  void unregister();
+
+  int mSerial;
+  SharedMemory<Table> mShared;
+
+  // Ownership of the calling process
+  std::mutex mMutex;
+  std::weak_ptr<const void> mOwnership;
+  Schedule mSchedule;
+  pid_t mPid = 0;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_CARDSCHEDULE_H
@@ -0,0 +1,197 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file FileLock.cxx
+/// \brief Implementation of the FileLock class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+#include "Lla/Locks/FileLock.h"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace o2
+{
+namespace lla
+{
+
+namespace
+{
+
+// Real-time signal used to interrupt a blocking F_OFD_SETLKW once the timeout has expired
+int wakeupSignal()
+{
+  return SIGRTMIN + 4;
+}
+
+void wakeupHandler(int)
+{
+}
+
+// Install the handler without SA_RESTART, so that fcntl() returns EINTR
+// Only done if nobody else has claimed the signal
+// \return true if the signal interrupts fcntl(), false if the application handles it otherwise
+bool installWakeupHandler()
+{
+  static std::once_flag flag;
+  std::call_once(flag, []() {
+    struct sigaction current;
+    if (sigaction(wakeupSignal(), nullptr, &current) == 0 && current.sa_handler == SIG_DFL) {
+      struct sigaction action;
+      memset(&action, 0, sizeof(action));
+      action.sa_handler = wakeupHandler;
+      sigemptyset(&action.sa_mask);
+      sigaction(wakeupSignal(), &action, nullptr);
+    }
+  });
+
+  // The application may have ignored the signal, or set a handler of its own, before or since
+  struct sigaction current;
+  return sigaction(wakeupSignal(), nullptr, &current) == 0 && current.sa_handler == wakeupHandler &&
+         !(current.sa_flags & SA_RESTART);
+}
+
+struct flock makeFlock(short type)
+{
+  struct flock fl;
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = type;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = 0;
+  fl.l_len = 0; // the whole file
+  fl.l_pid = 0; // required for OFD locks
+  return fl;
+}
+
+timespec toTimespec(std::chrono::nanoseconds ns)
+{
+  timespec ts;
+  ts.tv_sec = ns.count() / 1000000000;
+  ts.tv_nsec = ns.count() % 1000000000;
+  return ts;
+}
+
+} // anonymous namespace
+
+FileLock::FileLock(const LockParameters& params)
+  : InterprocessLockBase(params),
+    mFileLockPath(FILE_LOCK_DIRECTORY + mLockName + ".lock")
+{
+  mFileFd = open(mFileLockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+  if (mFileFd < 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't open lock file " + mFileLockPath + ": " + strerror(errno)));
+  }
+  fchmod(mFileFd, 0666); // Don't let the umask keep other users out; best effort
+}
+
+FileLock::~FileLock()
+{
+  unlock();
+  close(mFileFd);
+}
+
+LockStatus::Type FileLock::tryAcquire()
+{
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  }
+
+  struct flock fl = makeFlock(F_WRLCK);
+  if (fcntl(mFileFd, F_OFD_SETLK, &fl) < 0) {
+    if (errno == EAGAIN || errno == EACCES) {
+      return LockStatus::Busy;
+    }
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't lock file " + mFileLockPath + ": " + strerror(errno)));
+  }
+
+  mLocked = true;
+  return LockStatus::Acquired;
+}
+
+LockStatus::Type FileLock::timedAcquire(int timeOut)
+{
+  auto status = tryAcquire();
+  if (status != LockStatus::Busy) {
+    return status;
+  } else if (timeOut <= 0) {
+    return LockStatus::TimedOut;
+  } else if (mWaitStrategy != WaitStrategy::Park || !installWakeupHandler()) {
+    // Without the wakeup signal a blocking fcntl() couldn't be bounded; poll instead
+    return retryLock(timeOut);
+  }
+
+  // Arm a timer that signals this thread at the deadline, and keeps signalling it periodically
+  // afterwards, in case it fired before we made it into fcntl()
+  struct sigevent sev;
+  memset(&sev, 0, sizeof(sev));
+  sev.sigev_notify = SIGEV_THREAD_ID;
+  sev.sigev_signo = wakeupSignal();
+  sev.sigev_notify_thread_id = syscall(SYS_gettid);
+
+  timer_t timer;
+  if (timer_create(CLOCK_MONOTONIC, &sev, &timer) < 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't create timer for " + mFileLockPath + ": " + strerror(errno)));
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+  struct itimerspec its;
+  its.it_value = toTimespec(deadline.time_since_epoch());
+  its.it_interval = toTimespec(std::chrono::milliseconds(1));
+  timer_settime(timer, TIMER_ABSTIME, &its, nullptr);
+
+  sigset_t wakeupSet, oldSet;
+  sigemptyset(&wakeupSet);
+  sigaddset(&wakeupSet, wakeupSignal());
+  pthread_sigmask(SIG_UNBLOCK, &wakeupSet, &oldSet);
+
+  struct flock fl = makeFlock(F_WRLCK);
+  while (true) {
+    if (fcntl(mFileFd, F_OFD_SETLKW, &fl) == 0) {
+      mLocked = true;
+      break;
+    } else if (errno != EINTR || std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+  }
+
+  timer_delete(timer);
+  pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+
+  return mLocked ? LockStatus::Acquired : LockStatus::TimedOut;
+}
+
+void FileLock::unlock()
+{
+  if (mLocked) {
+    struct flock fl = makeFlock(F_UNLCK);
+    fcntl(mFileFd, F_OFD_SETLK, &fl);
+    mLocked = false;
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,82 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file FutexLock.cxx
+/// \brief Implementation of the FutexLock class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <chrono>
+
+#include "Lla/Locks/FutexLock.h"
+
+namespace o2
+{
+namespace lla
+{
+
+FutexLock::FutexLock(const LockParameters& params)
+  : InterprocessLockBase(params),
+    mShared(mLockName + "_futex")
+{
+}
+
+FutexLock::~FutexLock()
+{
+  unlock();
+}
+
+LockStatus::Type FutexLock::timedAcquire(int timeOut)
+{
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  } else if (mWaitStrategy != WaitStrategy::Park) {
+    return retryLock(timeOut);
+  }
+
+  uint32_t state = Free;
+  if (mShared->word.compare_exchange_strong(state, Locked, std::memory_order_acquire)) {
+    mLocked = true;
+    return LockStatus::Acquired;
+  }
+
+  // Mark the word as contended, so that the holder knows to wake us up on unlock
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+  if (state != Contended) {
+    state = mShared->word.exchange(Contended, std::memory_order_acquire);
+    if (state == Locked) { // First waiter; wake up a holder waiting for contention
+      futex::wake(&mShared->word);
+    }
+  }
+  while (state != Free) {
+    auto remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::nanoseconds(0)) {
+      return LockStatus::TimedOut;
+    }
+    futex::wait(&mShared->word, Contended, remaining);
+    state = mShared->word.exchange(Contended, std::memory_order_acquire);
+  }
+
+  mLocked = true;
+  return LockStatus::Acquired;
+}
+
+bool FutexLock::waitForContention(int timeOut)
+{
+  if (mLocked) {
+    futex::wait(&mShared->word, Locked, std::chrono::milliseconds(timeOut));
+  }
+  return mShared->word.load() == Contended;
+}
+
+} // namespace lla
+} // namespace o2
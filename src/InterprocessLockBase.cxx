@@ -17,9 +17,11 @@
 
 #include <chrono>
 #include <thread>
+#include <boost/throw_exception.hpp>
 
-#include "InterprocessLockBase.h"
+#include "Lla/Locks/InterprocessLockBase.h"
 #include "Lla/Exception.h"
+#include "Waiter.h"
 
 namespace o2
 {
@@ -27,7 +29,8 @@ namespace lla
 {
 
 InterprocessLockBase::InterprocessLockBase(const LockParameters& params)
-  : mLockName(params.getLockName().get_value_or("dummy"))
+  : mLockName(params.getLockName().get_value_or("dummy")),
+    mWaitStrategy(params.getWaitStrategy().get_value_or(WaitStrategy::Park))
 {
 }
 
@@ -35,5 +38,44 @@ InterprocessLockBase::~InterprocessLockBase()
 {
 }
 
+void InterprocessLockBase::lock()
+{
+  auto status = tryAcquire();
+  if (status == LockStatus::AlreadyLocked) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Already locked " + mLockName));
+  } else if (status != LockStatus::Acquired) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't lock " + mLockName));
+  }
+}
+
+bool InterprocessLockBase::tryLock()
+{
+  return tryAcquire() == LockStatus::Acquired;
+}
+
+bool InterprocessLockBase::timedLock(int timeOut)
+{
+  return timedAcquire(timeOut) == LockStatus::Acquired;
+}
+
+bool InterprocessLockBase::waitForContention(int timeOut)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(timeOut));
+  return false;
+}
+
+LockStatus::Type InterprocessLockBase::retryLock(int timeOut)
+{
+  Waiter waiter(mWaitStrategy, timeOut);
+  do {
+    auto status = tryAcquire();
+    if (status != LockStatus::Busy) {
+      return status;
+    }
+  } while (waiter.pause());
+
+  return LockStatus::TimedOut;
+}
+
 } // namespace lla
 } // namespace o2
@@ -20,8 +20,12 @@
 
 #include "Lla/Exception.h"
 #include "InterprocessLockFactory.h"
-#include "NamedMutex.h"
-#include "SocketLock.h"
+#include "Lla/Locks/FileLock.h"
+#include "Lla/Locks/FutexLock.h"
+#include "Lla/Locks/NamedMutex.h"
+#include "Lla/Locks/RobustMutex.h"
+#include "Lla/Locks/SocketLock.h"
+#include "Lla/Locks/TicketLock.h"
 
 namespace o2
 {
@@ -34,6 +38,14 @@ std::unique_ptr<InterprocessLockInterface> InterprocessLockFactory::getInterproc
     return std::make_unique<SocketLock>(params);
   } else if (params.getLockTypeRequired() == LockType::Type::NamedMutex) {
     return std::make_unique<NamedMutex>(params);
+  } else if (params.getLockTypeRequired() == LockType::Type::FileLock) {
+    return std::make_unique<FileLock>(params);
+  } else if (params.getLockTypeRequired() == LockType::Type::FutexLock) {
+    return std::make_unique<FutexLock>(params);
+  } else if (params.getLockTypeRequired() == LockType::Type::RobustMutex) {
+    return std::make_unique<RobustMutex>(params);
+  } else if (params.getLockTypeRequired() == LockType::Type::TicketLock) {
+    return std::make_unique<TicketLock>(params);
   } else {
     BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Unknown LockType provided"));
   }
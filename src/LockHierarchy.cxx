@@ -0,0 +1,275 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file LockHierarchy.cxx
+/// \brief Implementation of the LockHierarchy class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <signal.h>
+#include <string>
+#include <unistd.h>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+#include "Lla/Locks/Futex.h"
+#include "LockHierarchy.h"
+
+namespace o2
+{
+namespace lla
+{
+
+constexpr int LockHierarchy::kEndpoints;
+constexpr int LockHierarchy::kLinks;
+constexpr int LockHierarchy::kRegisterGroups;
+constexpr int LockHierarchy::kMaxGrants;
+
+namespace
+{
+enum Usage : uint32_t {
+  Unused = 0,
+  Announced,
+  InUse
+};
+
+// Upper bound for the waits, so that grants of dead processes are noticed
+constexpr std::chrono::milliseconds kReclaimSlice(100);
+
+constexpr int kMaxDepth = 4;
+
+bool isAlive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+int nodeIndex(int endpoint, int link, int registerGroup)
+{
+  constexpr int kLinksBase = 1 + LockHierarchy::kEndpoints;
+  constexpr int kRegisterGroupsBase = kLinksBase + LockHierarchy::kEndpoints * LockHierarchy::kLinks;
+  if (endpoint < 0) {
+    return 0;
+  } else if (link < 0) {
+    return 1 + endpoint;
+  } else if (registerGroup < 0) {
+    return kLinksBase + endpoint * LockHierarchy::kLinks + link;
+  } else {
+    return kRegisterGroupsBase + (endpoint * LockHierarchy::kLinks + link) * LockHierarchy::kRegisterGroups + registerGroup;
+  }
+}
+} // anonymous namespace
+
+void LockHierarchy::checkNode(const Node& node)
+{
+  bool valid = node.endpoint < kEndpoints && node.link < kLinks && node.registerGroup < kRegisterGroups &&
+               (node.link < 0 || node.endpoint >= 0) && (node.registerGroup < 0 || node.link >= 0);
+  if (!valid) {
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Invalid lock hierarchy node: endpoint " + std::to_string(node.endpoint) + ", link " + std::to_string(node.link) + ", register group " + std::to_string(node.registerGroup)));
+  }
+}
+
+void LockHierarchy::initTable(Table& table)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&table.mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  // Rows: held mode, columns: requested mode
+  const uint8_t compatible[4][4] = {
+    // IS IX  S  X
+    { 1, 1, 1, 0 }, // IS
+    { 1, 1, 0, 0 }, // IX
+    { 1, 0, 1, 0 }, // S
+    { 0, 0, 0, 0 }  // X
+  };
+  std::memcpy(table.compatible, compatible, sizeof(compatible));
+}
+
+LockHierarchy::LockHierarchy(int serial)
+  : mShared("_CRU_" + std::to_string(serial) + "_lla_hierarchy", initTable)
+{
+}
+
+bool LockHierarchy::inUse()
+{
+  return mShared->usage.load() != Unused;
+}
+
+bool LockHierarchy::announce()
+{
+  uint32_t usage = Unused;
+  if (mShared->usage.compare_exchange_strong(usage, Announced)) {
+    return true;
+  }
+  return usage != InUse;
+}
+
+void LockHierarchy::setInUse()
+{
+  mShared->usage.store(InUse);
+}
+
+LockStatus::Type LockHierarchy::tryAcquire(const Node& node, Mode mode, uint32_t& ticket)
+{
+  return attempt(node, mode, ticket);
+}
+
+LockStatus::Type LockHierarchy::timedAcquire(const Node& node, Mode mode, int timeOut, uint32_t& ticket)
+{
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+  const bool writer = mode == Exclusive || mode == IntentionExclusive;
+  uint32_t waitingTicket = 0;
+  LockStatus::Type status;
+  try {
+    while (true) {
+      uint32_t generation = mShared->generation.load();
+      status = attempt(node, mode, ticket);
+      if (status != LockStatus::Busy) {
+        break;
+      }
+
+      auto left = deadline - std::chrono::steady_clock::now();
+      if (left <= std::chrono::nanoseconds(0)) {
+        status = LockStatus::TimedOut;
+        break;
+      }
+      if (writer && !waitingTicket) {
+        // Keep new readers out until we're through
+        attempt(node, mode, waitingTicket, true);
+      }
+      futex::wait(&mShared->generation, generation, std::min<std::chrono::nanoseconds>(left, kReclaimSlice));
+    }
+  } catch (...) {
+    if (waitingTicket) {
+      release(waitingTicket);
+    }
+    throw;
+  }
+
+  if (waitingTicket) {
+    release(waitingTicket);
+  }
+  return status;
+}
+
+void LockHierarchy::release(uint32_t ticket)
+{
+  lockTable();
+  for (auto& grant : mShared->grants) {
+    if (grant.pid != 0 && grant.ticket == ticket) {
+      grant.pid = 0;
+    }
+  }
+  pthread_mutex_unlock(&mShared->mutex);
+
+  mShared->generation.fetch_add(1);
+  futex::wakeAll(&mShared->generation);
+}
+
+std::atomic<uint32_t>& LockHierarchy::releases()
+{
+  return mShared->generation;
+}
+
+/// Grants the node and the intention locks on its ancestors, all or nothing
+LockStatus::Type LockHierarchy::attempt(const Node& node, Mode mode, uint32_t& ticket, bool waiting)
+{
+  const bool reader = mode == Shared || mode == IntentionShared;
+  const Mode intention = reader ? IntentionShared : IntentionExclusive;
+  int nodes[kMaxDepth] = { nodeIndex(-1, -1, -1) };
+  Mode modes[kMaxDepth] = { intention };
+  int depth = 1;
+  if (node.endpoint >= 0) {
+    nodes[depth] = nodeIndex(node.endpoint, -1, -1);
+    modes[depth++] = intention;
+  }
+  if (node.link >= 0) {
+    nodes[depth] = nodeIndex(node.endpoint, node.link, -1);
+    modes[depth++] = intention;
+  }
+  if (node.registerGroup >= 0) {
+    nodes[depth] = nodeIndex(node.endpoint, node.link, node.registerGroup);
+    modes[depth++] = intention;
+  }
+  modes[depth - 1] = mode;
+
+  lockTable();
+  auto& table = *mShared;
+  int freeSlots = 0;
+  for (auto& grant : table.grants) {
+    if (grant.pid == 0) {
+      freeSlots++;
+      continue;
+    } else if (waiting || (grant.waiting && !reader)) {
+      continue;
+    }
+    for (int i = 0; i < depth; ++i) {
+      if (grant.node == nodes[i] && !table.compatible[grant.mode][modes[i]]) {
+        if (isAlive(grant.pid)) {
+          pthread_mutex_unlock(&table.mutex);
+          return LockStatus::Busy;
+        }
+        grant.pid = 0; // Reclaimed from a dead process
+        freeSlots++;
+        break;
+      }
+    }
+  }
+
+  if (freeSlots < depth) {
+    pthread_mutex_unlock(&table.mutex);
+    if (waiting) { // Just no writer preference then
+      return LockStatus::Busy;
+    }
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Lock hierarchy has no room for more grants"));
+  }
+
+  if (++table.nextTicket == 0) {
+    ++table.nextTicket;
+  }
+  ticket = table.nextTicket;
+  int i = 0;
+  for (auto& grant : table.grants) {
+    if (grant.pid == 0 && i < depth) {
+      grant.ticket = ticket;
+      grant.node = nodes[i];
+      grant.mode = modes[i++];
+      grant.waiting = waiting;
+      std::atomic_signal_fence(std::memory_order_release);
+      grant.pid = getpid(); // Last, so that a half-written grant stays free
+    }
+  }
+  pthread_mutex_unlock(&table.mutex);
+  return LockStatus::Acquired;
+}
+
+void LockHierarchy::lockTable()
+{
+  int result = pthread_mutex_lock(&mShared->mutex);
+  if (result == EOWNERDEAD) {
+    // Grants are only valid once complete, so the table is consistent as is
+    pthread_mutex_consistent(&mShared->mutex);
+  } else if (result != 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't lock the lock hierarchy: " + std::string(strerror(result))));
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,114 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file LockHierarchy.h
+/// \brief Definition of the LockHierarchy class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_LOCKHIERARCHY_H
+#define O2_LLA_SRC_LOCKHIERARCHY_H
+
+#include <cstdint>
+#include <pthread.h>
+
+#include "Lla/InterprocessLockInterface.h"
+#include "Lla/Locks/SharedMemory.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Multi-granularity locks on the parts of a card: card → endpoint → link → register group
+///
+/// A node is locked in one of four modes; its ancestors are locked in the matching intention
+/// mode, so that e.g. two links are locked exclusively at the same time, while locking the card
+/// exclusively waits for both. The grants, and the compatibility matrix of the modes, live in
+/// shared memory, guarded by a robust mutex; grants of processes that died are reclaimed.
+///
+/// Writers have the preference: while a timed acquisition in an exclusive mode waits, it queues
+/// its grants as waiting, and acquisitions in shared modes treat them as held.
+class LockHierarchy
+{
+ public:
+  static constexpr int kEndpoints = 2;
+  static constexpr int kLinks = 24;          // Per endpoint
+  static constexpr int kRegisterGroups = 16; // Per link
+
+  enum Mode : uint8_t {
+    IntentionShared,
+    IntentionExclusive,
+    Shared,
+    Exclusive
+  };
+
+  /// A node of the hierarchy; unset levels are -1, e.g. { 0, -1, -1 } is endpoint 0
+  struct Node {
+    int endpoint = -1;
+    int link = -1;
+    int registerGroup = -1;
+  };
+
+  /// \throws o2::lla::ParameterException if the node is out of the hierarchy
+  static void checkNode(const Node& node);
+
+  LockHierarchy(int serial);
+
+  /// \return true if nodes below the card or endpoints may be locked
+  bool inUse();
+
+  /// Announces that nodes below the card or endpoints are about to be locked
+  /// \return true if the caller has to wait for the holders of the card before calling setInUse()
+  bool announce();
+  void setInUse();
+
+  /// \param ticket Set to identify the grants on success, for release()
+  LockStatus::Type tryAcquire(const Node& node, Mode mode, uint32_t& ticket);
+  LockStatus::Type timedAcquire(const Node& node, Mode mode, int timeOut, uint32_t& ticket);
+  void release(uint32_t ticket);
+
+  /// \return Futex word bumped, and woken, on every release
+  std::atomic<uint32_t>& releases();
+
+ private:
+  static constexpr int kMaxGrants = 256;
+
+  struct Grant {
+    int32_t pid; // 0 for a free slot
+    uint32_t ticket;
+    uint16_t node;
+    uint8_t mode;
+    uint8_t waiting; // Queued by a waiting writer, only held against readers
+  };
+
+  struct Table {
+    pthread_mutex_t mutex;
+    std::atomic<uint32_t> usage;
+    std::atomic<uint32_t> generation; // Futex word, bumped on every release
+    uint32_t nextTicket;
+    uint8_t compatible[4][4];
+    Grant grants[kMaxGrants];
+  };
+
+  static void initTable(Table& table);
+  /// \param waiting Queue the grants as waiting, instead of taking them, ignoring conflicts
+  LockStatus::Type attempt(const Node& node, Mode mode, uint32_t& ticket, bool waiting = false);
+  void lockTable();
+
+  SharedMemory<Table> mShared;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_LOCKHIERARCHY_H
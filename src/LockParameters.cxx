@@ -15,8 +15,9 @@
 ///
 /// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
 
+#include <cstdio>
+#include <cstring>
 #include <boost/throw_exception.hpp>
-#include <map>
 #include "Lla/Exception.h"
 #include "Lla/LockParameters.h"
 
@@ -25,112 +26,131 @@ namespace o2
 namespace lla
 {
 
-using Variant = boost::variant<std::string, LockType::Type>;
-using KeyType = const char*;
-using Map = std::map<KeyType, Variant>;
-
-struct ParametersPimpl {
-  Map map;
-};
+constexpr std::size_t LockParameters::kMaxLockNameLength;
 
 namespace
 {
-
 template <typename T>
-void setParam(Map& map, KeyType key, const T& value)
+auto getParamRequired(const boost::optional<T>& param, const char* key) -> T
 {
-  map[key] = Variant{ value };
+  if (param) {
+    return *param;
+  } else {
+    BOOST_THROW_EXCEPTION(ParameterException()
+                          << ErrorInfo::Message("Parameter was not set")
+                          << ErrorInfo::Message(key));
+  }
 }
 
-template <typename T>
-auto getParam(const Map& map, KeyType key) -> boost::optional<T>
+/// \return true for the names of the locks of cards and endpoints, "_CRU_<serial>[_<endpoint>]_lla_lock"
+bool isCardLockName(const char* name, std::size_t length)
 {
-  auto it = map.find(key);
-  if (it != map.end()) {
-    auto var = it->second;
-    auto val = boost::get<T>(var);
-    return val;
-  } else {
-    return boost::none;
-  }
+  constexpr char kPrefix[] = "_CRU_";
+  constexpr char kSuffix[] = "_lla_lock";
+  constexpr std::size_t kPrefixLength = sizeof(kPrefix) - 1;
+  constexpr std::size_t kSuffixLength = sizeof(kSuffix) - 1;
+  return length > kPrefixLength + kSuffixLength && std::strncmp(name, kPrefix, kPrefixLength) == 0 &&
+         std::strcmp(name + length - kSuffixLength, kSuffix) == 0;
 }
 
-template <typename T>
-auto getParamRequired(const Map& map, KeyType key) -> T
+unsigned long hashDjb2(const char* str, std::size_t length)
 {
-  if (auto optional = getParam<T>(map, key)) {
-    return *optional;
-  } else {
-    BOOST_THROW_EXCEPTION(ParameterException()
-                          << ErrorInfo::Message("Parameter was not set")
-                          << ErrorInfo::Message(key));
+  unsigned long hash = 5381;
+  for (std::size_t i = 0; i < length; ++i) {
+    hash = 33 * hash + (unsigned char)str[i];
   }
+  return hash;
 }
 } // anonymous namespace
 
 #define _PARAMETER_FUNCTIONS(_param_name, _key_string)                              \
   auto LockParameters::set##_param_name(_param_name##Type value)->LockParameters&   \
   {                                                                                 \
-    setParam(mPimpl->map, _key_string, value);                                      \
+    m##_param_name = value;                                                         \
     return *this;                                                                   \
   }                                                                                 \
                                                                                     \
   auto LockParameters::get##_param_name() const->boost::optional<_param_name##Type> \
   {                                                                                 \
-    return getParam<_param_name##Type>(mPimpl->map, _key_string);                   \
+    return m##_param_name;                                                          \
   }                                                                                 \
                                                                                     \
   auto LockParameters::get##_param_name##Required() const->_param_name##Type        \
   {                                                                                 \
-    return getParamRequired<_param_name##Type>(mPimpl->map, _key_string);           \
+    return getParamRequired(m##_param_name, _key_string);                           \
   }
 
 _PARAMETER_FUNCTIONS(LockType, "lock_type")
-_PARAMETER_FUNCTIONS(LockName, "lock_name")
+_PARAMETER_FUNCTIONS(WaitStrategy, "wait_strategy")
 
 #undef _PARAMETER_FUNCTIONS
 
-LockParameters::LockParameters() : mPimpl(std::make_unique<ParametersPimpl>())
+auto LockParameters::setLockName(const LockNameType& value) -> LockParameters&
 {
+  return setLockName(value.c_str());
 }
 
-LockParameters::LockParameters(const LockParameters& other)
+auto LockParameters::setLockName(const char* value) -> LockParameters&
 {
-  mPimpl = std::make_unique<ParametersPimpl>();
-  mPimpl->map = other.mPimpl->map;
+  auto length = std::strlen(value);
+  if (isCardLockName(value, length)) {
+    BOOST_THROW_EXCEPTION(ParameterException()
+                          << ErrorInfo::Message("Lock name reserved for the Sessions on a card")
+                          << ErrorInfo::Message(value));
+  }
+
+  if (length > kMaxLockNameLength) {
+    // Keep the beginning, which tells what the lock is for, and tell names apart by the hash
+    constexpr std::size_t kHashLength = 16;
+    constexpr std::size_t kKept = kMaxLockNameLength - kHashLength - 1;
+    std::memcpy(mLockName, value, kKept);
+    std::snprintf(mLockName + kKept, kHashLength + 2, "_%016lx", hashDjb2(value, length));
+  } else {
+    std::memcpy(mLockName, value, length + 1);
+  }
+  mHasLockName = true;
+  return *this;
 }
 
-LockParameters::LockParameters(LockParameters&& other)
+auto LockParameters::getLockName() const -> boost::optional<LockNameType>
 {
-  mPimpl = std::move(other.mPimpl);
+  if (!mHasLockName) {
+    return boost::none;
+  }
+  return LockNameType(mLockName);
 }
 
-LockParameters::~LockParameters()
+auto LockParameters::getLockNameRequired() const -> LockNameType
 {
+  return getParamRequired(getLockName(), "lock_name");
 }
 
-LockParameters& LockParameters::operator=(const LockParameters& other)
+auto LockParameters::getLockNameView() const -> const char*
 {
-  if (&other == this) {
-    return *this;
-  }
-
-  if (!mPimpl) {
-    mPimpl = std::make_unique<ParametersPimpl>();
-  }
-  mPimpl->map = other.mPimpl->map;
-  return *this;
+  return mHasLockName ? mLockName : nullptr;
 }
 
-LockParameters& LockParameters::operator=(LockParameters&& other)
+namespace detail
 {
-  if (&other == this) {
-    return *this;
+LockParameters cardLockParameters(int serial, int endpoint)
+{
+  LockParameters params;
+  if (endpoint < 0) {
+    std::snprintf(params.mLockName, sizeof(params.mLockName), "_CRU_%d_lla_lock", serial);
+  } else {
+    std::snprintf(params.mLockName, sizeof(params.mLockName), "_CRU_%d_%d_lla_lock", serial, endpoint);
   }
-
-  mPimpl = std::move(other.mPimpl);
-  return *this;
+  params.mHasLockName = true;
+  return params.setLockType(LockType::SocketLock);
 }
+} // namespace detail
+
+LockParameters::LockParameters() = default;
+LockParameters::LockParameters(const LockParameters& other) = default;
+LockParameters::LockParameters(LockParameters&& other) = default;
+LockParameters::~LockParameters() = default;
+LockParameters& LockParameters::operator=(const LockParameters& other) = default;
+LockParameters& LockParameters::operator=(LockParameters&& other) = default;
 
 } // namespace lla
 } // namespace o2
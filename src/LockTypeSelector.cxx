@@ -0,0 +1,288 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file LockTypeSelector.cxx
+/// \brief Implementation of the LockTypeSelector class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <signal.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+#include "Lla/Locks/SharedMemory.h"
+#include "InterprocessLockFactory.h"
+#include "LockTypeSelector.h"
+
+namespace o2
+{
+namespace lla
+{
+
+constexpr const char* LockTypeSelector::kEnvironmentVariable;
+
+namespace
+{
+constexpr int kUncontendedIterations = 200;
+constexpr int kHandoffRounds = 20;
+constexpr int kHandoffTimeOut = 100;                          // ms; a waiter not served by then fails the calibration
+constexpr std::chrono::microseconds kWaiterSettleTime(100);  // For the waiter to block on the lock
+constexpr std::chrono::seconds kCalibrationTimeOut(10);      // For another process's calibration to complete
+
+// Only locks released when their holder dies, and by any thread of the holder: Sessions may
+// be stopped by another thread than the one that started them
+const LockType::Type kCandidates[] = {
+  LockType::SocketLock,
+  LockType::FileLock
+};
+
+bool isCandidate(int32_t lockType)
+{
+  return std::find(std::begin(kCandidates), std::end(kCandidates), LockType::Type(lockType)) != std::end(kCandidates);
+}
+
+/// Calibration result shared by the processes of the host; zero until calibrated
+struct CalibrationRecord {
+  std::atomic<int32_t> calibrator; // pid of the calibrating process
+  std::atomic<int32_t> lockType;   // Calibrated lock type + 1
+};
+
+bool isAlive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+std::string calibrationLockName()
+{
+  return "_lla_calibration_" + std::to_string(getpid());
+}
+
+/// \return true if the entry of /dev/shm was made for the lock, e.g. "sem.<lock>" or "<lock>_futex"
+bool isMadeFor(const char* entry, const std::string& lockName)
+{
+  if (std::strncmp(entry, "sem.", 4) == 0) {
+    entry += 4;
+  }
+  // The implementations add suffixes starting with '.' or '_'; not digits, as of another pid
+  return std::strncmp(entry, lockName.c_str(), lockName.size()) == 0 &&
+         (entry[lockName.size()] == '\0' || entry[lockName.size()] == '.' || entry[lockName.size()] == '_');
+}
+
+/// Removes the segments, semaphores and files the lock implementations left in /dev/shm
+void removeCalibrationLocks()
+{
+  const auto lockName = calibrationLockName();
+  if (DIR* directory = opendir("/dev/shm")) {
+    while (dirent* entry = readdir(directory)) {
+      if (isMadeFor(entry->d_name, lockName)) {
+        unlinkat(dirfd(directory), entry->d_name, 0);
+      }
+    }
+    closedir(directory);
+  }
+}
+
+const std::pair<const char*, LockType::Type> kNames[] = {
+  { "socket-lock", LockType::SocketLock },
+  { "named-mutex", LockType::NamedMutex },
+  { "file-lock", LockType::FileLock },
+  { "futex-lock", LockType::FutexLock },
+  { "robust-mutex", LockType::RobustMutex },
+  { "ticket-lock", LockType::TicketLock },
+  { "auto", LockType::Auto }
+};
+} // anonymous namespace
+
+boost::optional<LockType::Type> LockTypeSelector::fromString(const char* name)
+{
+  for (const auto& entry : kNames) {
+    if (std::strcmp(entry.first, name) == 0) {
+      return entry.second;
+    }
+  }
+  return boost::none;
+}
+
+const char* LockTypeSelector::toString(LockType::Type lockType)
+{
+  for (const auto& entry : kNames) {
+    if (entry.second == lockType) {
+      return entry.first;
+    }
+  }
+  return "unknown";
+}
+
+LockType::Type LockTypeSelector::select(boost::optional<LockType::Type> requested)
+{
+  auto lockType = requested.get_value_or(LockType::SocketLock);
+
+  const char* environment = std::getenv(kEnvironmentVariable);
+  if (environment && *environment) {
+    auto overridden = fromString(environment);
+    if (!overridden) {
+      BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message(std::string("Unknown lock type in ") + kEnvironmentVariable + ": " + environment));
+    }
+    lockType = *overridden;
+  }
+
+  return lockType == LockType::Auto ? calibrated() : lockType;
+}
+
+LockType::Type LockTypeSelector::calibrated()
+{
+  static std::atomic<int> cached{ 0 };
+  if (auto lockType = cached.load()) {
+    return LockType::Type(lockType - 1);
+  }
+
+  SharedMemory<CalibrationRecord> record("lla_lock_type_calibration");
+  int32_t recorded = record->lockType.load();
+  if (recorded != 0 && !isCandidate(recorded - 1)) { // Calibrated among more lock types until now
+    record->lockType.compare_exchange_strong(recorded, 0);
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + kCalibrationTimeOut;
+  while (record->lockType.load() == 0) {
+    int32_t calibrator = 0;
+    if (record->calibrator.compare_exchange_strong(calibrator, getpid())) {
+      if (record->lockType.load() == 0) { // Someone else may have completed in the meantime
+        record->lockType.store(calibrate() + 1);
+      }
+      record->calibrator.store(0);
+    } else if (!isAlive(calibrator)) { // Died calibrating; take over
+      record->calibrator.compare_exchange_strong(calibrator, 0);
+    } else if (std::chrono::steady_clock::now() > deadline) {
+      BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Lock type calibration by process " + std::to_string(calibrator) + " didn't complete"));
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  cached.store(record->lockType.load());
+  return LockType::Type(cached.load() - 1);
+}
+
+LockType::Type LockTypeSelector::calibrate()
+{
+  auto best = LockType::SocketLock;
+  auto bestLatency = std::chrono::nanoseconds::max();
+  for (auto lockType : kCandidates) {
+    if (auto measurement = measure(lockType)) {
+      auto latency = measurement->uncontended + measurement->handoff;
+      if (latency < bestLatency) {
+        best = lockType;
+        bestLatency = latency;
+      }
+    }
+  }
+  removeCalibrationLocks();
+  return best;
+}
+
+boost::optional<LockTypeSelector::Measurement> LockTypeSelector::measure(LockType::Type lockType)
+{
+  using clock = std::chrono::steady_clock;
+
+  try {
+    // A name of our own, so that leftovers of a calibrator that died don't get in the way
+    const auto params = LockParameters::makeParameters(lockType)
+                          .setLockName(calibrationLockName());
+    auto holder = InterprocessLockFactory::getInterprocessLock(params);
+    auto waiter = InterprocessLockFactory::getInterprocessLock(params);
+
+    Measurement measurement;
+    auto start = clock::now();
+    for (int i = 0; i < kUncontendedIterations; ++i) {
+      if (holder->tryAcquire() != LockStatus::Acquired) {
+        return boost::none;
+      }
+      holder->unlock();
+    }
+    measurement.uncontended = (clock::now() - start) / kUncontendedIterations;
+
+    // Each round, the holder releases the lock while the waiter is blocked on it, from another
+    // thread, as the lock may be thread-affine
+    enum Phase { Idle,
+                 Requested,
+                 Waiting };
+    std::atomic<int> phase{ Idle };
+    std::atomic<clock::rep> releasedAt{ 0 };
+    std::atomic<bool> failed{ false };
+    std::vector<clock::duration> handoffs;
+
+    std::thread waiterThread([&]() {
+      try {
+        for (int round = 0; round < kHandoffRounds && !failed; ++round) {
+          while (phase.load() != Requested && !failed) {
+            std::this_thread::yield();
+          }
+          phase.store(Waiting);
+          if (waiter->timedAcquire(kHandoffTimeOut) == LockStatus::Acquired) {
+            handoffs.push_back(clock::now() - clock::time_point(clock::duration(releasedAt.load())));
+            waiter->unlock();
+          } else {
+            failed = true;
+          }
+          phase.store(Idle);
+        }
+      } catch (const std::exception&) {
+        failed = true;
+      }
+    });
+
+    try {
+      for (int round = 0; round < kHandoffRounds && !failed; ++round) {
+        if (holder->tryAcquire() != LockStatus::Acquired) {
+          failed = true;
+          break;
+        }
+        phase.store(Requested);
+        while (phase.load() != Waiting && !failed) {
+          std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(kWaiterSettleTime);
+        releasedAt.store(clock::now().time_since_epoch().count());
+        holder->unlock();
+        while (phase.load() != Idle && !failed) {
+          std::this_thread::yield();
+        }
+      }
+    } catch (const std::exception&) {
+      failed = true;
+    }
+    waiterThread.join();
+
+    if (failed) {
+      return boost::none;
+    }
+    std::nth_element(handoffs.begin(), handoffs.begin() + handoffs.size() / 2, handoffs.end());
+    measurement.handoff = handoffs[handoffs.size() / 2];
+    return measurement;
+  } catch (const std::exception&) {
+    // Not available on this host
+    return boost::none;
+  }
+}
+
+} // namespace lla
+} // namespace o2
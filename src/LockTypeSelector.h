@@ -0,0 +1,72 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file LockTypeSelector.h
+/// \brief Definition of the LockTypeSelector class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_LOCKTYPESELECTOR_H
+#define O2_LLA_SRC_LOCKTYPESELECTOR_H
+
+#include <chrono>
+#include <boost/optional.hpp>
+
+#include "Lla/ParameterTypes/LockType.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Chooses the lock implementation of a Session
+///
+/// The O2_LLA_LOCK_TYPE environment variable overrides the requested type; it takes the names of
+/// the LlaBench --lock-type option, or "auto". The Auto type is resolved by calibrating the lock
+/// implementations once per host; the result is kept in shared memory, so that all processes
+/// agree on it, until the next reboot.
+class LockTypeSelector
+{
+ public:
+  /// Name of the environment variable overriding the lock type
+  static constexpr const char* kEnvironmentVariable = "O2_LLA_LOCK_TYPE";
+
+  /// \param requested The requested lock type, if any; defaults to the SocketLock
+  /// \return The lock type to use, never Auto
+  /// \throws o2::lla::ParameterException if the environment variable holds an unknown type
+  static LockType::Type select(boost::optional<LockType::Type> requested);
+
+  /// \return The calibrated lock type of this host, calibrating it if needed
+  static LockType::Type calibrated();
+
+  /// Parses a lock type name, e.g. "futex-lock"
+  static boost::optional<LockType::Type> fromString(const char* name);
+
+  /// \return The name of a lock type, as parsed by fromString()
+  static const char* toString(LockType::Type lockType);
+
+ private:
+  struct Measurement {
+    std::chrono::nanoseconds uncontended;
+    std::chrono::nanoseconds handoff;
+  };
+
+  /// Measures the uncontended and handoff latencies of a lock implementation
+  /// \return none if the implementation doesn't work on this host
+  static boost::optional<Measurement> measure(LockType::Type lockType);
+  static LockType::Type calibrate();
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_LOCKTYPESELECTOR_H
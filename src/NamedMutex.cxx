@@ -18,10 +18,11 @@
 #include <iostream>
 #include <chrono>
 #include <fcntl.h>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/throw_exception.hpp>
 
 #include "Lla/Exception.h"
-#include "NamedMutex.h"
+#include "Lla/Locks/NamedMutex.h"
 
 namespace o2
 {
@@ -39,43 +40,37 @@ NamedMutex::~NamedMutex()
   unlock();
 }
 
-void NamedMutex::lock()
+LockStatus::Type NamedMutex::tryAcquire()
 {
-  if (!mLocked) {
-    try {
-      if (mMutex.try_lock()) {
-        mLocked = true;
-      } else {
-        BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("whoops"));
-      }
-    } catch (bip::interprocess_exception& e) {
-      BOOST_THROW_EXCEPTION(e);
-    }
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
   }
-}
 
-bool NamedMutex::tryLock()
-{
   try {
-    lock();
-    return true;
-  } catch (const LlaException& e) {
+    mLocked = mMutex.try_lock();
+  } catch (bip::interprocess_exception& e) {
+    BOOST_THROW_EXCEPTION(e);
   }
-  return false;
+
+  return mLocked ? LockStatus::Acquired : LockStatus::Busy;
 }
 
-bool NamedMutex::timedLock(int timeOut)
+LockStatus::Type NamedMutex::timedAcquire(int timeOut)
 {
-  const auto start = std::chrono::steady_clock::now();
-  auto timeExceeded = [&]() { return ((std::chrono::steady_clock::now() - start) > std::chrono::milliseconds(timeOut)); };
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  } else if (mWaitStrategy != WaitStrategy::Park) {
+    return retryLock(timeOut);
+  }
 
-  while (!timeExceeded()) {
-    if (tryLock()) {
-      return true;
-    }
+  auto deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(timeOut);
+  try {
+    mLocked = mMutex.timed_lock(deadline);
+  } catch (bip::interprocess_exception& e) {
+    BOOST_THROW_EXCEPTION(e);
   }
 
-  return false;
+  return mLocked ? LockStatus::Acquired : LockStatus::TimedOut;
 }
 
 void NamedMutex::unlock()
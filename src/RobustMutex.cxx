@@ -0,0 +1,125 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file RobustMutex.cxx
+/// \brief Implementation of the RobustMutex class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+#include "Lla/Locks/RobustMutex.h"
+
+namespace o2
+{
+namespace lla
+{
+
+namespace
+{
+void initRobustMutex(pthread_mutex_t& mutex)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+  pthread_mutex_init(&mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+} // anonymous namespace
+
+RobustMutex::RobustMutex(const LockParameters& params)
+  : InterprocessLockBase(params),
+    mShared(mLockName + "_robust", initRobustMutex)
+{
+}
+
+RobustMutex::~RobustMutex()
+{
+  // Best effort; destroyed by another thread than the holder, the mutex stays locked until the
+  // holder exits
+  if (mLocked) {
+    pthread_mutex_unlock(mShared.get());
+  }
+}
+
+LockStatus::Type RobustMutex::tryAcquire()
+{
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  }
+
+  return handleResult(pthread_mutex_trylock(mShared.get())) ? LockStatus::Acquired : LockStatus::Busy;
+}
+
+LockStatus::Type RobustMutex::timedAcquire(int timeOut)
+{
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  } else if (mWaitStrategy != WaitStrategy::Park) {
+    return retryLock(timeOut);
+  }
+
+  // pthread_mutex_timedlock() takes an absolute CLOCK_REALTIME deadline
+  timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeOut / 1000;
+  deadline.tv_nsec += (timeOut % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  return handleResult(pthread_mutex_timedlock(mShared.get(), &deadline)) ? LockStatus::Acquired : LockStatus::TimedOut;
+}
+
+void RobustMutex::unlock()
+{
+  if (!mLocked) {
+    return;
+  }
+
+  int result = pthread_mutex_unlock(mShared.get());
+  if (result == EPERM) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Robust mutex " + mLockName + " can only be unlocked by the thread that locked it"));
+  } else if (result != 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't unlock robust mutex " + mLockName + ": " + strerror(result)));
+  }
+  mLocked = false;
+}
+
+/// Turns the result of a locking call into the lock state, recovering from a dead holder
+bool RobustMutex::handleResult(int result)
+{
+  if (result == EOWNERDEAD) {
+    // The previous holder died while holding the lock; the mutex guards access to the card,
+    // not any data in shared memory, so it can be handed over as is
+    pthread_mutex_consistent(mShared.get());
+    result = 0;
+  }
+
+  if (result == 0) {
+    mLocked = true;
+  } else if (result == ENOTRECOVERABLE) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Robust mutex " + mLockName + " is not recoverable"));
+  }
+
+  return mLocked;
+}
+
+} // namespace lla
+} // namespace o2
@@ -15,27 +15,585 @@
 ///
 /// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <signal.h>
+#include <thread>
+
 #include "ReadoutCard/Exception.h"
 
+#include "Lla/BasicSession.h"
 #include "Lla/Exception.h"
 #include "Lla/Session.h"
 
-#include "InterprocessLockFactory.h"
+#include "Lla/Locks/Futex.h"
+#include "Lla/Locks/SharedMemory.h"
+
+#include "CardArbiter.h"
+#include "CardLockType.h"
+#include "CardQuota.h"
+#include "CardSchedule.h"
+#include "LockHierarchy.h"
+#include "LockTypeSelector.h"
+#include "WaitForGraph.h"
+#include "Waiter.h"
 
 namespace o2
 {
 namespace lla
 {
 
+namespace
+{
+constexpr int kEndpoints = 2;
+
+// Upper bound for the waits on several cards, for releases nobody announces: locks of processes
+// that died, endpoint locks taken by Card Sessions
+constexpr std::chrono::milliseconds kAnySlice(100);
+
+// Waiters gain a priority level per interval waited
+constexpr std::chrono::seconds kAgingInterval(1);
+
+// Upper bound for the waits in the queue, as aging reorders it without notice
+constexpr std::chrono::milliseconds kQueueSlice(10);
+
+// Whether Endpoint Sessions are used on a card; Card Sessions then take the endpoint locks too
+enum EndpointUsage : uint32_t {
+  Unused = 0,
+  Announced, // An Endpoint Session is about to go through the card lock
+  InUse
+};
+
+bool isAlive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+roc::SerialId findSerialId(const SessionParameters& params)
+{
+  try {
+    return boost::apply_visitor(SerialIdVisitor(), params.getCardIdRequired());
+  } catch (const roc::Exception& e) {
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message(e.what()));
+  }
+}
+
+WaitForGraph::Scope makeGraphScope(const std::tuple<int, int, int, int>& scope, AccessMode::Type accessMode)
+{
+  return { std::get<0>(scope), std::get<1>(scope), std::get<2>(scope), std::get<3>(scope), accessMode == AccessMode::Shared };
+}
+
+/// \throws o2::lla::ParameterException if the Schedule has slots, none of them for the class
+void checkScheduled(const Schedule& schedule, ClientClass::Type clientClass)
+{
+  bool scheduled = schedule.size() == 0;
+  for (int slot = 0; slot < schedule.size(); ++slot) {
+    scheduled = scheduled || schedule[slot].clientClass == clientClass;
+  }
+  if (!scheduled) {
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Schedule has no slot for the ClientClass of the Session"));
+  }
+}
+
+/// \param wait Set to the time until the next slot of the class, outside of them
+/// \return Time left in the current slot of the class, zero outside of them; contiguous slots of
+/// the class count as one
+std::chrono::nanoseconds slotTimeLeft(const Schedule& schedule, ClientClass::Type clientClass, std::chrono::nanoseconds& wait)
+{
+  const std::chrono::nanoseconds frame = std::chrono::milliseconds(schedule.getFrameLength());
+  const auto offset = std::chrono::steady_clock::now().time_since_epoch() % frame;
+  auto length = [&](int slot) -> std::chrono::nanoseconds { return std::chrono::milliseconds(schedule[slot].length); };
+
+  int slot = 0;
+  std::chrono::nanoseconds end = length(0);
+  while (offset >= end) {
+    end += length(++slot);
+  }
+  end -= offset;
+
+  // Up to the next slot of another class, or of the class
+  const int slots = schedule.size();
+  const bool own = schedule[slot].clientClass == clientClass;
+  for (int next = 1; next < slots && (schedule[(slot + next) % slots].clientClass == clientClass) == own; ++next) {
+    end += length((slot + next) % slots);
+  }
+  wait = own ? std::chrono::nanoseconds(0) : end;
+  return own ? end : std::chrono::nanoseconds(0);
+}
+
+/// \param endpoint The endpoint to lock, or -1 for the whole card
+LockParameters makeCardLockParameters(const SessionParameters& params, int serial, int endpoint)
+{
+  return detail::cardLockParameters(serial, endpoint)
+    .setWaitStrategy(params.getWaitStrategy().get_value_or(WaitStrategy::Park));
+}
+} // anonymous namespace
+
+namespace detail
+{
+/// Parts of a card kept for recipients by Session::handOff(), in shared memory: the whole card,
+/// then each endpoint
+struct Handoff {
+  enum State : uint32_t {
+    Free = 0,
+    Writing,
+    Reserved
+  };
+  static constexpr uint32_t kStateMask = 3;
+  static constexpr uint32_t kGeneration = 4; // The rest of the word counts the reservations
+
+  struct Slot {
+    std::atomic<uint32_t> word;    // Futex word; generation and state
+    std::atomic<int64_t> deadline; // In ns of the steady clock
+    char recipient[LockParameters::kMaxLockNameLength + 1];
+  };
+
+  Slot slots[1 + kEndpoints];
+};
+
+/// Leases on the parts of a card, in shared memory: the whole card, then each endpoint
+struct Lease {
+  struct Slot {
+    std::atomic<uint64_t> state;    // Generation, held bit, and expiry; see makeState()
+    std::atomic<uint32_t> releases; // Futex word, bumped when a lease ends or is revoked
+    std::atomic<int32_t> priority;  // Of the holder
+  };
+
+  /// \param expiry In ms of the steady clock, wrapping around
+  static uint64_t makeState(uint32_t generation, bool held, uint32_t expiry)
+  {
+    return uint64_t(generation << 1 | held) << 32 | expiry;
+  }
+  static uint32_t generation(uint64_t state) { return state >> 33; }
+  static bool held(uint64_t state) { return (state >> 32) & 1; }
+  static uint32_t expiry(uint64_t state) { return uint32_t(state); }
+
+  static uint32_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /// \return Time left until the expiry, negative once expired
+  static int32_t left(uint64_t state, uint32_t now) { return int32_t(expiry(state) - now); }
+
+  Slot slots[1 + kEndpoints];
+};
+
+/// Waiters for the parts of a card, in shared memory, ranked by priority and by how long they've
+/// waited; only waiters for overlapping parts, that exclude each other, come before one another
+struct WaitQueue {
+  static constexpr int kMaxEntries = 64;
+
+  struct Entry {
+    std::atomic<int32_t> pid; // 0 for a free entry, -1 while it's being written
+    int32_t priority;
+    int64_t since;                      // In ns of the steady clock
+    std::atomic<int64_t> yieldDeadline; // Once the waiter asks holders to yield, 0 before; see requestYield()
+    std::atomic<uint32_t> aside;        // Between the slots of a scheduled waiter; nobody waits for it
+    WaitForGraph::Scope scope;
+  };
+
+  /// \return The rank of a waiter; the highest comes first, then the one waiting longest
+  static int64_t rank(int32_t priority, int64_t since, int64_t now)
+  {
+    return priority + (now - since) / std::chrono::nanoseconds(kAgingInterval).count();
+  }
+
+  std::atomic<uint32_t> length;        // Entries taken; nobody waits while zero
+  std::atomic<uint32_t> generation;    // Futex word, bumped when a waiter leaves
+  std::atomic<uint32_t> yieldRequests; // Bumped when a waiter asks holders to yield
+  Entry entries[kMaxEntries];
+};
+
+LockParameters makeLockParameters(const SessionParameters& params)
+{
+  params.getSessionNameRequired();
+  return makeCardLockParameters(params, findSerialId(params).getSerial(), -1);
+}
+} // namespace detail
+
+namespace
+{
+/// The shared memory of a card, mapped once per process and kept for its lifetime, so that making
+/// a Session doesn't map it again
+class CardSegments
+{
+ public:
+  explicit CardSegments(int serial)
+    : mSerial(serial),
+      mEndpointUsage(makeName("_CRU_%d_lla_endpoints")),
+      mLockType(serial),
+      mSchedule(serial),
+      mQuota(serial),
+      mHierarchy(serial),
+      mHandoff(makeName("_CRU_%d_lla_handoff")),
+      mLease(makeName("_CRU_%d_lla_lease")),
+      mQueue(makeName("_CRU_%d_lla_queue"))
+  {
+  }
+
+  static std::shared_ptr<CardSegments> get(int serial)
+  {
+    static std::mutex registryMutex;
+    static std::map<int, std::shared_ptr<CardSegments>> registry;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto& segments = registry[serial];
+    if (!segments) {
+      segments = std::make_shared<CardSegments>(serial);
+    }
+    return segments;
+  }
+
+  std::atomic<uint32_t>* endpointUsage() { return mEndpointUsage.get(); }
+  CardLockType* lockType() { return &mLockType; }
+  CardSchedule* schedule() { return &mSchedule; }
+  CardQuota* quota() { return &mQuota; }
+  LockHierarchy* hierarchy() { return &mHierarchy; }
+  detail::Handoff* handoff() { return mHandoff.get(); }
+  detail::Lease* lease() { return mLease.get(); }
+  detail::WaitQueue* queue() { return mQueue.get(); }
+
+ private:
+  std::string makeName(const char* format)
+  {
+    char name[LockParameters::kMaxLockNameLength + 1];
+    std::snprintf(name, sizeof(name), format, mSerial);
+    return name;
+  }
+
+  int mSerial;
+  SharedMemory<std::atomic<uint32_t>> mEndpointUsage;
+  CardLockType mLockType;
+  CardSchedule mSchedule;
+  CardQuota mQuota;
+  LockHierarchy mHierarchy;
+  SharedMemory<detail::Handoff> mHandoff;
+  SharedMemory<detail::Lease> mLease;
+  SharedMemory<detail::WaitQueue> mQueue;
+};
+
+/// \return true if the slot of the handoff or lease, 0 for the whole card, overlaps the endpoint,
+/// -1 for the whole card
+bool overlaps(int slot, int endpoint)
+{
+  return slot == 0 || endpoint < 0 || slot == 1 + endpoint;
+}
+
+/// Holding the locks, checks that no part of the card overlapping the endpoint is kept for another
+/// Session than the named one, nor leased; then takes over those kept for it, and revokes expired
+/// leases
+/// \param preemption Time left until the caller revokes a lease of the given holder priority
+/// \param word Set to the value to wait on, if in the way
+/// \param left Set to the time left to the reservation or lease in the way
+/// \return The futex word of the reservation or lease in the way, or nullptr
+template <typename Preemption>
+std::atomic<uint32_t>* admitEndpoint(detail::Handoff& handoff, detail::Lease& leases, int endpoint, const std::string& name,
+                                     Preemption preemption, uint32_t& word, std::chrono::nanoseconds& left)
+{
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  for (int slot = 0; slot <= kEndpoints; ++slot) {
+    auto& reservation = handoff.slots[slot];
+    if (!overlaps(slot, endpoint)) {
+      continue;
+    }
+    while (true) {
+      word = reservation.word.load(std::memory_order_acquire);
+      if ((word & detail::Handoff::kStateMask) != detail::Handoff::Reserved) {
+        break;
+      }
+      // The reservation is written by the holder of its part, which may not be ours
+      char recipient[sizeof(reservation.recipient)];
+      std::memcpy(recipient, reservation.recipient, sizeof(recipient));
+      auto deadline = std::chrono::nanoseconds(reservation.deadline.load());
+      if (reservation.word.load() != word) {
+        continue;
+      }
+      if (now < deadline && std::strncmp(recipient, name.c_str(), sizeof(recipient)) != 0) {
+        left = deadline - now;
+        return &reservation.word;
+      }
+      break;
+    }
+  }
+
+  const uint32_t leaseNow = detail::Lease::now();
+  for (int slot = 0; slot <= kEndpoints; ++slot) {
+    auto& lease = leases.slots[slot];
+    if (!overlaps(slot, endpoint)) {
+      continue;
+    }
+    word = lease.releases.load();
+    auto state = lease.state.load();
+    while (detail::Lease::held(state)) {
+      auto leaseLeft = detail::Lease::left(state, leaseNow);
+      auto preemptLeft = preemption(lease.priority.load(std::memory_order_relaxed));
+      if (leaseLeft > 0 && preemptLeft > std::chrono::nanoseconds(0)) {
+        left = std::min<std::chrono::nanoseconds>(std::chrono::milliseconds(leaseLeft), preemptLeft);
+        return &lease.releases;
+      }
+      // Expired, or not yielded when asked; whoever holds it hasn't renewed it, or stopped, in time
+      auto revoked = detail::Lease::makeState(detail::Lease::generation(state), false, detail::Lease::expiry(state));
+      if (lease.state.compare_exchange_strong(state, revoked)) {
+        lease.releases.fetch_add(1);
+        futex::wakeAll(&lease.releases);
+        break;
+      }
+    }
+  }
+
+  for (int slot = 0; slot <= kEndpoints; ++slot) {
+    auto& reservation = handoff.slots[slot];
+    word = reservation.word.load(std::memory_order_acquire);
+    if (overlaps(slot, endpoint) && (word & detail::Handoff::kStateMask) == detail::Handoff::Reserved &&
+        reservation.word.compare_exchange_strong(word, word & ~detail::Handoff::kStateMask)) {
+      futex::wakeAll(&reservation.word);
+    }
+  }
+  return nullptr;
+}
+
+/// \return true if part of the card overlapping the endpoint is kept for the named Session
+bool keptFor(detail::Handoff& handoff, int endpoint, const std::string& name)
+{
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  for (int slot = 0; slot <= kEndpoints; ++slot) {
+    auto& reservation = handoff.slots[slot];
+    if (overlaps(slot, endpoint) &&
+        (reservation.word.load(std::memory_order_acquire) & detail::Handoff::kStateMask) == detail::Handoff::Reserved &&
+        now < std::chrono::nanoseconds(reservation.deadline.load()) &&
+        std::strncmp(reservation.recipient, name.c_str(), sizeof(reservation.recipient)) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// \param entry The caller's entry in the queue, or -1 if it has none
+/// \return true if another waiter in the queue, for a part of the card the scope conflicts with,
+/// comes before the caller
+bool isOutranked(detail::WaitQueue& queue, int entry, int32_t priority, const WaitForGraph::Scope& scope)
+{
+  if (queue.length.load() <= (entry >= 0 ? 1u : 0u)) {
+    return false;
+  }
+
+  const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  const int64_t since = entry >= 0 ? queue.entries[entry].since : now;
+  const int64_t rank = detail::WaitQueue::rank(priority, since, now);
+  for (int i = 0; i < detail::WaitQueue::kMaxEntries; ++i) {
+    auto& other = queue.entries[i];
+    int32_t pid = other.pid.load(std::memory_order_acquire);
+    if (i == entry || pid <= 0 || other.aside.load(std::memory_order_relaxed) ||
+        !WaitForGraph::conflict(other.scope, scope)) {
+      continue;
+    }
+    int64_t otherRank = detail::WaitQueue::rank(other.priority, other.since, now);
+    if (otherRank > rank || (otherRank == rank && other.since < since)) {
+      if (isAlive(pid)) {
+        return true;
+      } else if (other.pid.compare_exchange_strong(pid, 0)) { // Left by a waiter that died
+        queue.length.fetch_sub(1);
+      }
+    }
+  }
+  return false;
+}
+
+/// Takes an entry in the queue, ranked from now on
+/// \return The entry, or -1 if the queue is full; the caller then waits unranked
+int takeQueueEntry(detail::WaitQueue& queue, int32_t priority, const WaitForGraph::Scope& scope)
+{
+  for (int i = 0; i < detail::WaitQueue::kMaxEntries; ++i) {
+    auto& entry = queue.entries[i];
+    int32_t free = 0;
+    if (entry.pid.load(std::memory_order_relaxed) == 0 && entry.pid.compare_exchange_strong(free, -1)) {
+      entry.priority = priority;
+      entry.since = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      entry.yieldDeadline.store(0, std::memory_order_relaxed);
+      entry.aside.store(false, std::memory_order_relaxed);
+      entry.scope = scope;
+      entry.pid.store(getpid(), std::memory_order_release);
+      queue.length.fetch_add(1);
+      return i;
+    }
+  }
+  return -1;
+}
+
+/// Gives up the entry in the queue, waking up the waiters it came before
+void leaveQueueEntry(detail::WaitQueue& queue, int entry)
+{
+  queue.entries[entry].pid.store(0, std::memory_order_release);
+  queue.length.fetch_sub(1);
+  queue.generation.fetch_add(1);
+  futex::wakeAll(&queue.generation);
+}
+} // anonymous namespace
+
+namespace detail
+{
+CardState::CardState(const SessionParameters& params, LockType::Type lockType)
+  : mSessionName(params.getSessionNameRequired()),
+    mParams(params),
+    mLockType(lockType),
+    mSerial(findSerialId(params).getSerial())
+{
+  auto segments = CardSegments::get(mSerial);
+  mLockTypeUse = segments->lockType()->use(lockType);
+  mEndpointUsage = std::shared_ptr<std::atomic<uint32_t>>(segments, segments->endpointUsage());
+  mHierarchy = std::shared_ptr<LockHierarchy>(segments, segments->hierarchy());
+  mHandoff = std::shared_ptr<Handoff>(segments, segments->handoff());
+  mLease = std::shared_ptr<Lease>(segments, segments->lease());
+  mQueue = std::shared_ptr<WaitQueue>(segments, segments->queue());
+  mSchedule = std::shared_ptr<CardSchedule>(segments, segments->schedule());
+  mQuota = std::shared_ptr<CardQuota>(segments, segments->quota());
+  checkScheduled(mSchedule->get(), ClientClass::Control);
+}
+
+CardState::~CardState()
+{
+  leaveQueue();
+}
+
+LockStatus::Type CardState::admit(int timeOut)
+{
+  mBlocking = nullptr;
+  mBlockingLeft = std::chrono::nanoseconds(0);
+  const auto schedule = mSchedule->get();
+  if (schedule.size() > 0 && slotTimeLeft(schedule, ClientClass::Control, mBlockingLeft).count() == 0) {
+    return LockStatus::Busy;
+  }
+  const int holdQuota = mQuota->get(ClientClass::Control);
+  if (holdQuota > 0 && mQuota->delay(ClientClass::Control).count() > 0) {
+    mBlockingLeft = mQuota->delay(ClientClass::Control);
+    return LockStatus::Busy;
+  }
+
+  auto status = LockStatus::Acquired;
+  if (mEndpointUsage->load() != Unused) {
+    // Endpoint Sessions are around; take both endpoints, in order, all or nothing
+    int held = 0;
+    auto releaseHeld = [&]() {
+      while (held-- > 0) {
+        mEndpointArbiters[held]->release();
+      }
+    };
+    try {
+      for (; held < kEndpoints; ++held) {
+        if (!mEndpointArbiters[held]) {
+          auto endpointLockParams = makeCardLockParameters(mParams, mSerial, held).setLockType(mLockType);
+          mEndpointArbiters[held] = CardArbiter::getCardArbiter(endpointLockParams);
+        }
+        status = timeOut < 0 ? mEndpointArbiters[held]->tryAcquire() : mEndpointArbiters[held]->timedAcquire(timeOut);
+        if (status != LockStatus::Acquired) {
+          releaseHeld();
+          return status;
+        }
+      }
+    } catch (...) {
+      releaseHeld();
+      throw;
+    }
+    mEndpointsHeld = true;
+  }
+
+  if (mHierarchy->inUse()) {
+    // Sessions on links are around; wait for them as well
+    try {
+      status = timeOut < 0 ? mHierarchy->tryAcquire(LockHierarchy::Node(), LockHierarchy::Exclusive, mHierarchyTicket)
+                           : mHierarchy->timedAcquire(LockHierarchy::Node(), LockHierarchy::Exclusive, timeOut, mHierarchyTicket);
+    } catch (...) {
+      release();
+      throw;
+    }
+    if (status != LockStatus::Acquired) {
+      mHierarchyTicket = 0;
+      release();
+      return status;
+    }
+  }
+
+  // Sampled before the check, so that a waiter leaving in between isn't missed
+  const uint32_t generation = mQueue->generation.load();
+  const WaitForGraph::Scope scope = { mSerial, -1, -1, -1, false };
+  if (isOutranked(*mQueue, mQueueEntry, 0, scope) && !keptFor(*mHandoff, -1, mSessionName)) {
+    release();
+    mBlocking = &mQueue->generation;
+    mBlockingWord = generation;
+    mBlockingLeft = kQueueSlice;
+    return LockStatus::Busy;
+  }
+  auto noPreemption = [](int32_t) { return std::chrono::nanoseconds::max(); };
+  mBlocking = admitEndpoint(*mHandoff, *mLease, -1, mSessionName, noPreemption, mBlockingWord, mBlockingLeft);
+  if (mBlocking) {
+    release();
+    return LockStatus::Busy;
+  }
+  mHoldQuota = holdQuota;
+  mStartTime = std::chrono::steady_clock::now();
+  return LockStatus::Acquired;
+}
+
+void CardState::wait(int timeOut)
+{
+  auto left = std::min<std::chrono::nanoseconds>(mBlockingLeft, std::chrono::milliseconds(timeOut));
+  if (mBlocking) {
+    futex::wait(mBlocking, mBlockingWord, left);
+  } else {
+    std::this_thread::sleep_for(left);
+  }
+}
+
+void CardState::release()
+{
+  if (mHoldQuota > 0) {
+    mQuota->charge(ClientClass::Control, mHoldQuota, std::chrono::steady_clock::now() - mStartTime);
+    mHoldQuota = 0;
+  }
+  if (mHierarchyTicket) {
+    mHierarchy->release(mHierarchyTicket);
+    mHierarchyTicket = 0;
+  }
+  if (mEndpointsHeld) {
+    for (int endpoint = kEndpoints - 1; endpoint >= 0; --endpoint) {
+      mEndpointArbiters[endpoint]->release();
+    }
+    mEndpointsHeld = false;
+  }
+}
+
+void CardState::enqueue()
+{
+  if (mQueueEntry < 0) {
+    mQueueEntry = takeQueueEntry(*mQueue, 0, { mSerial, -1, -1, -1, false });
+  }
+}
+
+void CardState::leaveQueue()
+{
+  if (mQueueEntry >= 0) {
+    leaveQueueEntry(*mQueue, mQueueEntry);
+    mQueueEntry = -1;
+  }
+}
+} // namespace detail
+
 #ifdef O2_LLA_BENCH_ENABLED
 #pragma message("O2_LLA_BENCH_ENABLED defined")
 Session::Session(SessionParameters& params, LockType::Type lockType)
 {
   mParams = SessionParameters(params);
   checkAndSetParameters();
-  makeLockName();
   mLockParams.setLockType(lockType);
-  mLock = InterprocessLockFactory::getInterprocessLock(mLockParams);
+  makeArbiters();
 }
 #endif
 
@@ -43,28 +601,79 @@ Session::Session(SessionParameters& params)
 {
   mParams = SessionParameters(params);
   checkAndSetParameters();
-  makeLockName();
-  mLock = InterprocessLockFactory::getInterprocessLock(mLockParams);
+  makeArbiters();
 }
 
 Session::Session(const Session& other)
 {
   mSessionName = other.mSessionName;
-  mCardId = other.mCardId;
   mParams = other.mParams;
   mLockParams = other.mLockParams;
-  mLock = InterprocessLockFactory::getInterprocessLock(mLockParams);
-  mIsStarted = false;
+  mBiasGracePeriod = other.mBiasGracePeriod;
+  mReentrant = other.mReentrant;
+  mSerial = other.mSerial;
+  mEndpoint = other.mEndpoint;
+  mLinkId = other.mLinkId;
+  mRegisterGroup = other.mRegisterGroup;
+  mAccessMode = other.mAccessMode;
+  mGranularity = other.mGranularity;
+  mArbiter = other.mArbiter;
+  mCardArbiter = other.mCardArbiter;
+  mLockTypeUse = other.mLockTypeUse;
+  mEndpointArbiters = other.mEndpointArbiters;
+  mEndpointUsage = other.mEndpointUsage;
+  mHierarchy = other.mHierarchy;
+  mHandoff = other.mHandoff;
+  mLease = other.mLease;
+  mLeaseTime = other.mLeaseTime;
+  mQueue = other.mQueue;
+  mPriority = other.mPriority;
+  mPreemptTimeOut = other.mPreemptTimeOut;
+  mQuota = other.mQuota;
+  mQuotaOwnership = other.mQuotaOwnership;
+  mClientClass = other.mClientClass;
+  mHoldQuota = other.mHoldQuota;
+  mSchedule = other.mSchedule;
+  mScheduleOwnership = other.mScheduleOwnership;
 }
 
 Session::Session(Session&& other)
 {
   mSessionName = other.mSessionName;
-  mCardId = other.mCardId;
   mParams = other.mParams;
   mLockParams = other.mLockParams;
-  mLock = std::move(other.mLock);
-  mIsStarted = other.mIsStarted;
+  mBiasGracePeriod = other.mBiasGracePeriod;
+  mReentrant = other.mReentrant;
+  mSerial = other.mSerial;
+  mEndpoint = other.mEndpoint;
+  mLinkId = other.mLinkId;
+  mRegisterGroup = other.mRegisterGroup;
+  mAccessMode = other.mAccessMode;
+  mGranularity = other.mGranularity;
+  mArbiter = other.mArbiter;
+  mCardArbiter = other.mCardArbiter;
+  mLockTypeUse = other.mLockTypeUse;
+  mEndpointArbiters = other.mEndpointArbiters;
+  mEndpointUsage = other.mEndpointUsage;
+  mHierarchy = other.mHierarchy;
+  mHandoff = other.mHandoff;
+  mLease = other.mLease;
+  mLeaseTime = other.mLeaseTime;
+  mQueue = other.mQueue;
+  mPriority = other.mPriority;
+  mPreemptTimeOut = other.mPreemptTimeOut;
+  mQuota = other.mQuota;
+  mQuotaOwnership = other.mQuotaOwnership;
+  mClientClass = other.mClientClass;
+  mHoldQuota = other.mHoldQuota;
+  mSchedule = other.mSchedule;
+  mScheduleOwnership = other.mScheduleOwnership;
+  mEndpointsHeld = other.mEndpointsHeld;
+  mHierarchyTicket = other.mHierarchyTicket;
+  mGraphEntry = other.mGraphEntry;
+  mLeaseGeneration = other.mLeaseGeneration;
+  mStartTime = other.mStartTime;
+  mState = other.mState.exchange(State::Stopped);
 }
 
 Session& Session::operator=(const Session& other)
@@ -73,12 +682,36 @@ Session& Session::operator=(const Session& other)
     return *this;
   }
 
+  stop();
   mSessionName = other.mSessionName;
-  mCardId = other.mCardId;
   mParams = other.mParams;
   mLockParams = other.mLockParams;
-  mLock = InterprocessLockFactory::getInterprocessLock(mLockParams);
-  mIsStarted = false;
+  mBiasGracePeriod = other.mBiasGracePeriod;
+  mReentrant = other.mReentrant;
+  mSerial = other.mSerial;
+  mEndpoint = other.mEndpoint;
+  mLinkId = other.mLinkId;
+  mRegisterGroup = other.mRegisterGroup;
+  mAccessMode = other.mAccessMode;
+  mGranularity = other.mGranularity;
+  mArbiter = other.mArbiter;
+  mCardArbiter = other.mCardArbiter;
+  mLockTypeUse = other.mLockTypeUse;
+  mEndpointArbiters = other.mEndpointArbiters;
+  mEndpointUsage = other.mEndpointUsage;
+  mHierarchy = other.mHierarchy;
+  mHandoff = other.mHandoff;
+  mLease = other.mLease;
+  mLeaseTime = other.mLeaseTime;
+  mQueue = other.mQueue;
+  mPriority = other.mPriority;
+  mPreemptTimeOut = other.mPreemptTimeOut;
+  mQuota = other.mQuota;
+  mQuotaOwnership = other.mQuotaOwnership;
+  mClientClass = other.mClientClass;
+  mHoldQuota = other.mHoldQuota;
+  mSchedule = other.mSchedule;
+  mScheduleOwnership = other.mScheduleOwnership;
   return *this;
 }
 
@@ -87,95 +720,814 @@ Session& Session::operator=(Session&& other)
   if (this == &other) {
     return *this;
   }
+
+  stop();
   mSessionName = other.mSessionName;
-  mCardId = other.mCardId;
   mParams = other.mParams;
   mLockParams = other.mLockParams;
-  mLock = std::move(mLock);
-  mIsStarted = other.mIsStarted;
+  mBiasGracePeriod = other.mBiasGracePeriod;
+  mReentrant = other.mReentrant;
+  mSerial = other.mSerial;
+  mEndpoint = other.mEndpoint;
+  mLinkId = other.mLinkId;
+  mRegisterGroup = other.mRegisterGroup;
+  mAccessMode = other.mAccessMode;
+  mGranularity = other.mGranularity;
+  mArbiter = other.mArbiter;
+  mCardArbiter = other.mCardArbiter;
+  mLockTypeUse = other.mLockTypeUse;
+  mEndpointArbiters = other.mEndpointArbiters;
+  mEndpointUsage = other.mEndpointUsage;
+  mHierarchy = other.mHierarchy;
+  mHandoff = other.mHandoff;
+  mLease = other.mLease;
+  mLeaseTime = other.mLeaseTime;
+  mQueue = other.mQueue;
+  mPriority = other.mPriority;
+  mPreemptTimeOut = other.mPreemptTimeOut;
+  mQuota = other.mQuota;
+  mQuotaOwnership = other.mQuotaOwnership;
+  mClientClass = other.mClientClass;
+  mHoldQuota = other.mHoldQuota;
+  mSchedule = other.mSchedule;
+  mScheduleOwnership = other.mScheduleOwnership;
+  mEndpointsHeld = other.mEndpointsHeld;
+  mHierarchyTicket = other.mHierarchyTicket;
+  mGraphEntry = other.mGraphEntry;
+  mLeaseGeneration = other.mLeaseGeneration;
+  mStartTime = other.mStartTime;
+  mState = other.mState.exchange(State::Stopped);
   return *this;
 }
 
 /* Make sure that the session is stopped, so the lock is released */
 Session::~Session()
 {
-  stop();
+  try {
+    stop();
+  } catch (const LlaException&) {
+    // Destroyed by another thread than the one holding a mutex; it goes when that thread exits
+  }
 }
 
 void Session::checkAndSetParameters()
 {
   mSessionName = mParams.getSessionNameRequired();
 
+  auto serialId = findSerialId(mParams);
+  mSerial = serialId.getSerial();
+  mEndpoint = serialId.getEndpoint();
+  mLinkId = mParams.getLinkId().get_value_or(-1);
+  mRegisterGroup = mParams.getRegisterGroup().get_value_or(-1);
+  mAccessMode = mParams.getAccessMode().get_value_or(AccessMode::Exclusive);
+  LockHierarchy::Node node;
+  node.endpoint = mEndpoint;
+  node.link = mLinkId;
+  node.registerGroup = mRegisterGroup;
+  LockHierarchy::checkNode(node);
+  mGranularity = mParams.getLockGranularity().get_value_or(LockGranularity::Card);
+  mLockParams = makeCardLockParameters(mParams, mSerial, mGranularity == LockGranularity::Endpoint ? serialId.getEndpoint() : -1);
+  mLockParams.setLockType(LockTypeSelector::select(mParams.getLockType()));
+  mBiasGracePeriod = mParams.getBiasGracePeriod().get_value_or(0);
+  mReentrant = mParams.getReentrant().get_value_or(false);
+  mLeaseTime = mParams.getLeaseTime().get_value_or(0);
+  mPriority = mParams.getPriority().get_value_or(0);
+  mPreemptTimeOut = mParams.getPreemptTimeOut().get_value_or(-1);
+  mClientClass = mParams.getClientClass().get_value_or(ClientClass::Control);
+  auto holdQuota = mParams.getHoldQuota();
+  if (holdQuota && (*holdQuota < 1 || *holdQuota > 100)) {
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("HoldQuota has to be from 1 to 100%, was " + std::to_string(*holdQuota)));
+  }
+  checkScheduled(mParams.getSchedule().get_value_or(Schedule()), mClientClass);
+  if (mLeaseTime > 0 && (mLinkId >= 0 || mAccessMode == AccessMode::Shared)) {
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Only Sessions locking a whole card or endpoint exclusively can hold a lease"));
+  }
+}
+
+std::tuple<int, int, int, int> Session::scope() const
+{
+  int endpoint = (mLinkId >= 0 || mGranularity == LockGranularity::Endpoint) ? mEndpoint : -1;
+  return std::make_tuple(mSerial, endpoint, mLinkId, mRegisterGroup);
+}
+
+void Session::makeArbiters()
+{
+  // References into the segments of the card, which keep them mapped
+  auto segments = CardSegments::get(mSerial);
+  mLockTypeUse = segments->lockType()->use(mLockParams.getLockTypeRequired());
+
+  mArbiter = CardArbiter::getCardArbiter(mLockParams);
+  if (mGranularity == LockGranularity::Card) {
+    mCardArbiter = mArbiter;
+  } else {
+    auto cardLockParams = makeCardLockParameters(mParams, mSerial, -1)
+                            .setLockType(mLockParams.getLockTypeRequired());
+    mCardArbiter = CardArbiter::getCardArbiter(cardLockParams);
+  }
+
+  mEndpointUsage = std::shared_ptr<std::atomic<uint32_t>>(segments, segments->endpointUsage());
+  mHierarchy = std::shared_ptr<LockHierarchy>(segments, segments->hierarchy());
+  mHandoff = std::shared_ptr<detail::Handoff>(segments, segments->handoff());
+  mLease = std::shared_ptr<detail::Lease>(segments, segments->lease());
+  mQueue = std::shared_ptr<detail::WaitQueue>(segments, segments->queue());
+  mSchedule = std::shared_ptr<CardSchedule>(segments, segments->schedule());
+  if (mParams.getSchedule()) {
+    mScheduleOwnership = mSchedule->set(*mParams.getSchedule());
+  }
+  checkScheduled(mSchedule->get(), mClientClass);
+  mQuota = std::shared_ptr<CardQuota>(segments, segments->quota());
+  if (mParams.getHoldQuota()) {
+    mQuotaOwnership = mQuota->set(mClientClass, *mParams.getHoldQuota());
+  }
+}
+
+/// Takes the locks of the Session's scope, unless part of it is kept for, or leased by, another
+/// Session; with a LeaseTime, leases the scope and lets the locks go
+LockStatus::Type Session::acquire(Waiter* waiter)
+{
+  // Nesting in a Session of the same thread doesn't take anything from waiters
+  const bool nested = mReentrant && mArbiter->isOwner();
+  while (true) {
+    auto status = acquireLocks(waiter);
+    if (status != LockStatus::Acquired) {
+      return status;
+    }
+    if (!nested && outranked() && !keptForThis()) {
+      release(0);
+      return LockStatus::Busy;
+    }
+
+    uint32_t word;
+    std::chrono::nanoseconds left;
+    auto blocking = admit(word, left);
+    if (!blocking) {
+      if (mLeaseTime > 0) {
+        grantLease();
+        release(0);
+      }
+      return status;
+    }
+    release(0);
+    if (!waiter || waiter->expired()) {
+      return waiter ? LockStatus::TimedOut : LockStatus::Busy;
+    }
+
+    // Until the recipient takes over, or the lease ends, or either expires
+    futex::wait(blocking, word, std::min<std::chrono::nanoseconds>(left, std::chrono::milliseconds(waiter->remaining())));
+  }
+}
+
+/// Holding the locks, checks that no part of the card within the Session's scope is kept for
+/// another Session, nor leased; then takes over those kept for this one, and revokes expired leases
+/// \param word Set to the value to wait on, if in the way
+/// \param left Set to the time left to the reservation or lease in the way
+/// \return The futex word of the reservation or lease in the way, or nullptr
+std::atomic<uint32_t>* Session::admit(uint32_t& word, std::chrono::nanoseconds& left)
+{
+  return admitEndpoint(*mHandoff, *mLease, std::get<1>(scope()), mSessionName,
+                       [&](int32_t holderPriority) { return preemption(holderPriority); }, word, left);
+}
+
+/// \return true if part of the card within the Session's scope is kept for this Session
+bool Session::keptForThis()
+{
+  return keptFor(*mHandoff, std::get<1>(scope()), mSessionName);
+}
+
+/// \return true if another waiter in the queue, for a part of the card the Session's scope
+/// conflicts with, comes before this Session
+bool Session::outranked()
+{
+  return isOutranked(*mQueue, mQueueEntry, mPriority, makeGraphScope(scope(), mAccessMode));
+}
+
+/// Takes an entry in the queue, ranked from now on; when the queue is full, the Session waits unranked
+void Session::enqueue()
+{
+  if (mQueueEntry < 0) {
+    mQueueEntry = takeQueueEntry(*mQueue, mPriority, makeGraphScope(scope(), mAccessMode));
+  }
+}
+
+/// Gives up the entry in the queue, if any, waking up the waiters it came before
+void Session::leaveQueue()
+{
+  if (mQueueEntry >= 0) {
+    leaveQueueEntry(*mQueue, mQueueEntry);
+    mQueueEntry = -1;
+  }
+}
+
+/// Sets the entry in the queue, if any, aside while the Session doesn't wait, or back; setting it
+/// aside withdraws its yield request, and wakes up the waiters it came before
+void Session::setAside(bool aside)
+{
+  if (mQueueEntry < 0) {
+    return;
+  }
+  auto& queue = *mQueue;
+  auto& entry = queue.entries[mQueueEntry];
+  if (entry.aside.exchange(aside) != uint32_t(aside) && aside) {
+    entry.yieldDeadline.store(0);
+    queue.generation.fetch_add(1);
+    futex::wakeAll(&queue.generation);
+  }
+}
+
+/// Waits in the queue, attempting only while no other waiter comes first; an entry the Session
+/// already has is kept, for the caller to leave
+LockStatus::Type Session::acquireQueued(Waiter& waiter)
+{
+  auto& queue = *mQueue;
+  auto& releases = mArbiter->releases();
+
+  const bool queued = mQueueEntry >= 0;
+  enqueue();
+  // Announced for the whole wait, also while blocked in the lock, so that a biased holder notices
+  // it whatever the lock implementation
+  releases.waiters.fetch_add(1);
+  auto leave = [&]() {
+    releases.waiters.fetch_sub(1);
+    if (!queued) {
+      leaveQueue();
+    }
+  };
+
+  LockStatus::Type status;
   try {
-    mCardId = boost::apply_visitor(CardIdVisitor(), mParams.getCardIdRequired());
-  } catch (const roc::Exception& e) {
-    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message(e.what()));
+    while (true) {
+      std::atomic<uint32_t>* words[] = { &queue.generation, &releases.generation };
+      const uint32_t expected[] = { words[0]->load(), words[1]->load() };
+      if (!outranked()) {
+        requestYield();
+        status = acquire(&waiter);
+        if (status == LockStatus::Acquired) {
+          break;
+        }
+      }
+      if (waiter.expired()) {
+        status = LockStatus::TimedOut;
+        break;
+      }
+
+      // Until the card is released, or a waiter leaves
+      auto slice = std::min<std::chrono::nanoseconds>(std::chrono::milliseconds(waiter.remaining()), kQueueSlice);
+      if (!futex::waitAny(words, expected, 2, slice)) {
+        waiter.pause();
+      }
+    }
+  } catch (...) {
+    leave();
+    throw;
   }
+  leave();
+  return status;
 }
 
-bool Session::start()
+/// Asks the holders of conflicting scopes to yield, those of lower priority seeing it; for the first
+/// of the waiters the Session's scope conflicts with. The request stands until the Session leaves
+/// the queue.
+void Session::requestYield()
 {
-  // In case of start when mutex is kept, immediately return
-  std::unique_lock<std::mutex> ul(mMutex, std::try_to_lock);
-  if (!ul.owns_lock()) { return false; }
+  if (mQueueEntry < 0) {
+    return;
+  }
+  auto& entry = mQueue->entries[mQueueEntry];
+  if (entry.yieldDeadline.load(std::memory_order_relaxed) == 0) {
+    auto deadline = mPreemptTimeOut < 0 ? std::chrono::steady_clock::time_point::max()
+                                        : std::chrono::steady_clock::now() + std::chrono::milliseconds(mPreemptTimeOut);
+    entry.yieldDeadline.store(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count());
+    mQueue->yieldRequests.fetch_add(1);
+  }
+}
 
-  if (!isStarted()) {
-    if (mLock->tryLock()) {
-      mIsStarted = true;
-      return true;
+/// \param holderPriority The priority of the holder of the lease in the way
+/// \return Time left until this Session, asking the holder to yield, revokes the holder's lease
+std::chrono::nanoseconds Session::preemption(int32_t holderPriority)
+{
+  if (mQueueEntry < 0 || mPriority <= holderPriority) {
+    return std::chrono::nanoseconds::max();
+  }
+  auto deadline = mQueue->entries[mQueueEntry].yieldDeadline.load();
+  if (deadline == 0) {
+    return std::chrono::nanoseconds::max();
+  }
+  return std::chrono::nanoseconds(deadline) - std::chrono::steady_clock::now().time_since_epoch();
+}
+
+/// Charges the time held since the start to the class of the Session, if it had a HoldQuota then
+void Session::chargeQuota()
+{
+  if (mHoldQuota > 0) {
+    mQuota->charge(mClientClass, mHoldQuota, std::chrono::steady_clock::now() - mStartTime);
+  }
+}
+
+/// Holding the locks, and admitted, leases the Session's scope
+void Session::grantLease()
+{
+  auto& lease = mLease->slots[mGranularity == LockGranularity::Endpoint ? 1 + mEndpoint : 0];
+  mLeaseGeneration = (detail::Lease::generation(lease.state.load()) + 1) & 0x7fffffff;
+  lease.priority.store(mPriority, std::memory_order_relaxed);
+  lease.state.store(detail::Lease::makeState(mLeaseGeneration, true, detail::Lease::now() + mLeaseTime));
+}
+
+/// Ends the lease of the Session, unless it was revoked
+void Session::endLease()
+{
+  auto& lease = mLease->slots[mGranularity == LockGranularity::Endpoint ? 1 + mEndpoint : 0];
+  auto state = lease.state.load();
+  while (detail::Lease::held(state) && detail::Lease::generation(state) == mLeaseGeneration) {
+    if (lease.state.compare_exchange_weak(state, detail::Lease::makeState(mLeaseGeneration, false, detail::Lease::expiry(state)))) {
+      lease.releases.fetch_add(1);
+      futex::wakeAll(&lease.releases);
+      return;
+    }
+  }
+}
+
+/// Takes the locks of the Session's scope, trying once without a waiter
+LockStatus::Type Session::acquireLocks(Waiter* waiter)
+{
+  if (mLinkId >= 0 || mAccessMode == AccessMode::Shared) {
+    return acquireNode(waiter);
+  }
+
+  auto status = mGranularity == LockGranularity::Endpoint ? acquireEndpoint(waiter) : acquireCard(waiter);
+  if (status != LockStatus::Acquired || !mHierarchy->inUse()) {
+    return status;
+  }
+
+  // Sessions on links are around; wait for those within the scope as well
+  LockHierarchy::Node node;
+  if (mGranularity == LockGranularity::Endpoint) {
+    node.endpoint = mEndpoint;
+  }
+  try {
+    status = waiter ? mHierarchy->timedAcquire(node, LockHierarchy::Exclusive, waiter->remaining(), mHierarchyTicket)
+                    : mHierarchy->tryAcquire(node, LockHierarchy::Exclusive, mHierarchyTicket);
+  } catch (...) {
+    releaseScope(0);
+    throw;
+  }
+  if (status != LockStatus::Acquired) {
+    mHierarchyTicket = 0;
+    releaseScope(0);
+  }
+  return status;
+}
+
+LockStatus::Type Session::acquireFrom(CardArbiter& arbiter, Waiter* waiter)
+{
+  return waiter ? arbiter.timedAcquire(waiter->remaining(), mReentrant) : arbiter.tryAcquire(mReentrant);
+}
+
+LockStatus::Type Session::acquireCard(Waiter* waiter)
+{
+  auto status = acquireFrom(*mCardArbiter, waiter);
+  mEndpointsHeld = false;
+  if (status != LockStatus::Acquired || mEndpointUsage->load() == Unused) {
+    return status;
+  }
+
+  // Endpoint Sessions are around; take both endpoints, in order, all or nothing
+  int held = 0;
+  auto releaseHeld = [&]() {
+    while (held-- > 0) {
+      mEndpointArbiters[held]->release();
+    }
+    mCardArbiter->release();
+  };
+
+  try {
+    for (; held < kEndpoints; ++held) {
+      if (!mEndpointArbiters[held]) {
+        auto endpointLockParams = makeCardLockParameters(mParams, mSerial, held)
+                                    .setLockType(mLockParams.getLockTypeRequired());
+        mEndpointArbiters[held] = CardArbiter::getCardArbiter(endpointLockParams);
+      }
+      status = acquireFrom(*mEndpointArbiters[held], waiter);
+      if (status != LockStatus::Acquired) {
+        releaseHeld();
+        return status;
+      }
+    }
+  } catch (...) {
+    releaseHeld();
+    throw;
+  }
+
+  mEndpointsHeld = true;
+  return LockStatus::Acquired;
+}
+
+LockStatus::Type Session::acquireEndpoint(Waiter* waiter)
+{
+  // The first Endpoint Session of the card waits for Card Sessions that didn't take the
+  // endpoint locks; those starting after it see the usage and take them
+  if (mEndpointUsage->load() != InUse) {
+    uint32_t unused = Unused;
+    mEndpointUsage->compare_exchange_strong(unused, Announced);
+    auto status = acquireFrom(*mCardArbiter, waiter);
+    if (status != LockStatus::Acquired) {
+      return status;
+    }
+    mEndpointUsage->store(InUse);
+    mCardArbiter->release();
+  }
+  return acquireFrom(*mArbiter, waiter);
+}
+
+/// Locks the Session's node of the hierarchy, for Sessions on links or Shared Sessions
+LockStatus::Type Session::acquireNode(Waiter* waiter)
+{
+  // Likewise, the first Session on the hierarchy waits for the Sessions on the whole card or
+  // endpoints that didn't see it coming; those starting after it lock the hierarchy as well
+  if (mHierarchy->announce()) {
+    auto status = acquireCard(waiter);
+    if (status != LockStatus::Acquired) {
+      return status;
+    }
+    mHierarchy->setInUse();
+    releaseScope(0);
+  }
+
+  LockHierarchy::Node node;
+  if (mLinkId >= 0 || mGranularity == LockGranularity::Endpoint) {
+    node.endpoint = mEndpoint;
+  }
+  node.link = mLinkId;
+  node.registerGroup = mRegisterGroup;
+  auto mode = mAccessMode == AccessMode::Shared ? LockHierarchy::Shared : LockHierarchy::Exclusive;
+  auto status = waiter ? mHierarchy->timedAcquire(node, mode, waiter->remaining(), mHierarchyTicket)
+                       : mHierarchy->tryAcquire(node, mode, mHierarchyTicket);
+  if (status != LockStatus::Acquired) {
+    mHierarchyTicket = 0;
+  }
+  return status;
+}
+
+/// Releases the card, or the endpoint, as taken by acquireCard() or acquireEndpoint()
+void Session::releaseScope(int gracePeriod)
+{
+  if (mEndpointsHeld) {
+    for (int endpoint = kEndpoints - 1; endpoint >= 0; --endpoint) {
+      mEndpointArbiters[endpoint]->release(gracePeriod);
     }
+    mEndpointsHeld = false;
+    mCardArbiter->release(gracePeriod);
+  } else if (mGranularity == LockGranularity::Endpoint && mLinkId < 0 && mAccessMode == AccessMode::Exclusive) {
+    mArbiter->release(gracePeriod);
+  } else {
+    mCardArbiter->release(gracePeriod);
+  }
+}
+
+/// Releases the locks of the Session's scope; the card, or endpoint, first, as releasing it may
+/// throw, leaving everything held
+void Session::release(int gracePeriod)
+{
+  if (mLinkId < 0 && mAccessMode == AccessMode::Exclusive) {
+    releaseScope(gracePeriod);
+  }
+  if (mHierarchyTicket) {
+    mHierarchy->release(mHierarchyTicket);
+    mHierarchyTicket = 0;
+  }
+}
+
+bool Session::start()
+{
+  // In case of start while another thread starts or stops the Session, immediately return
+  State state = State::Stopped;
+  if (!mState.compare_exchange_strong(state, State::Starting)) {
+    return state == State::Started;
+  }
+
+  std::chrono::nanoseconds wait;
+  const auto schedule = mSchedule->get();
+  mHoldQuota = mQuota->get(mClientClass);
+  if ((mHoldQuota > 0 && mQuota->delay(mClientClass).count() > 0) || (schedule.size() > 0 && slotTimeLeft(schedule, mClientClass, wait).count() == 0)) {
+    mState = State::Stopped;
     return false;
   }
 
-  return true;
+  bool started = acquire(nullptr) == LockStatus::Acquired;
+  if (started) {
+    mGraphEntry = WaitForGraph::get().hold(makeGraphScope(scope(), mAccessMode));
+    mStartTime = std::chrono::steady_clock::now();
+  }
+  mState = started ? State::Started : State::Stopped;
+  return started;
 }
 
 bool Session::timedStart(int timeOut)
 {
-  // In case of timed start keep trying to take the mutex and start
-  const auto start = std::chrono::steady_clock::now();
-  auto timeExceeded = [&]() { return ((std::chrono::steady_clock::now() - start) > std::chrono::milliseconds(timeOut)); };
+  // In case of timed start wait for other threads starting or stopping the Session, then for the
+  // card, as the wait strategy dictates
+  Waiter waiter(mParams.getWaitStrategy().get_value_or(WaitStrategy::Park), timeOut);
+
+  State state = State::Stopped;
+  while (!mState.compare_exchange_weak(state, State::Starting)) {
+    if (state == State::Started) {
+      return true;
+    } else if (!waiter.pause()) {
+      return false;
+    }
+    state = State::Stopped;
+  }
 
-  while (!timeExceeded()) {
+  // Over budget, the class has to refill its bucket first; Sessions of the class starting and
+  // stopping in the meantime may push that back
+  mHoldQuota = mQuota->get(mClientClass);
+  for (auto delay = mHoldQuota > 0 ? mQuota->delay(mClientClass) : std::chrono::nanoseconds(0); delay.count() > 0; delay = mQuota->delay(mClientClass)) {
+    if (delay >= std::chrono::milliseconds(waiter.remaining())) {
+      mState = State::Stopped;
+      return false;
+    }
+    std::this_thread::sleep_for(delay);
+  }
 
-    std::unique_lock<std::mutex> ul(mMutex, std::try_to_lock);
-    if (!ul.owns_lock()) { continue; }
+  bool started;
+  try {
+    started = (mSchedule->get().size() > 0 ? acquireScheduled(waiter) : acquireWaiting(waiter)) == LockStatus::Acquired;
+  } catch (...) {
+    mState = State::Stopped;
+    throw;
+  }
+  if (started) {
+    mGraphEntry = WaitForGraph::get().hold(makeGraphScope(scope(), mAccessMode));
+    mStartTime = std::chrono::steady_clock::now();
+  }
+  mState = started ? State::Started : State::Stopped;
+  return started;
+}
 
-    if (!isStarted()) {
-      if (mLock->tryLock()) {
-        mIsStarted = true;
-        return true;
+/// Takes the card right away, or waits for it within the waiter's timeout
+LockStatus::Type Session::acquireWaiting(Waiter& waiter)
+{
+  auto status = acquire(nullptr);
+  if (status == LockStatus::Acquired) {
+    return status;
+  }
+
+  // Only a wait that doesn't succeed right away is recorded, and checked for deadlocks
+  auto& graph = WaitForGraph::get();
+  int waitEntry = -1;
+  try {
+    waitEntry = graph.wait(makeGraphScope(scope(), mAccessMode));
+    status = acquireQueued(waiter);
+  } catch (...) {
+    graph.remove(waitEntry);
+    throw;
+  }
+  graph.remove(waitEntry);
+  return status;
+}
+
+/// Waits for the card only within the slots of the Session's class, until the waiter's timeout
+LockStatus::Type Session::acquireScheduled(Waiter& waiter)
+{
+  // Queued across the slots, so that the wait ages as a whole; the entry is set aside in between,
+  // as the card then belongs to other classes
+  enqueue();
+  LockStatus::Type status;
+  try {
+    while (true) {
+      // The owners may clear the Schedule in the meantime
+      const auto schedule = mSchedule->get();
+      if (schedule.size() == 0) {
+        setAside(false);
+        status = acquireWaiting(waiter);
+        break;
+      }
+      std::chrono::nanoseconds wait;
+      auto left = slotTimeLeft(schedule, mClientClass, wait);
+      if (left.count() == 0) {
+        if (wait >= std::chrono::milliseconds(waiter.remaining())) {
+          status = LockStatus::TimedOut;
+          break;
+        }
+        setAside(true);
+        std::this_thread::sleep_for(wait);
+        continue;
+      }
+      setAside(false);
+
+      // Rounded up, so that the last ms of a slot isn't a zero timeout
+      auto slotTimeOut = std::chrono::ceil<std::chrono::milliseconds>(left).count();
+      Waiter slotWaiter(mParams.getWaitStrategy().get_value_or(WaitStrategy::Park), std::min<int>(waiter.remaining(), slotTimeOut));
+      status = acquireWaiting(slotWaiter);
+      if (status == LockStatus::Acquired || waiter.expired()) {
+        break;
+      }
+    }
+  } catch (...) {
+    leaveQueue();
+    throw;
+  }
+  leaveQueue();
+  return status;
+}
+
+Session* Session::timedStartAny(std::vector<Session>& sessions, int timeOut)
+{
+  Waiter waiter(WaitStrategy::Park, timeOut);
+  std::vector<std::atomic<uint32_t>*> words;
+  std::vector<uint32_t> expected;
+  std::vector<CardArbiter::Releases*> announced;
+
+  // Queued for the whole wait, so that waiters in timedStart() don't keep coming first
+  for (auto& session : sessions) {
+    session.enqueue();
+  }
+  auto leave = [&]() {
+    for (auto& session : sessions) {
+      session.leaveQueue();
+    }
+  };
+
+  Session* started = nullptr;
+  try {
+    while (true) {
+      // Sample the releases before the attempts, so that none in between is missed
+      words.clear();
+      expected.clear();
+      announced.clear();
+      for (auto& session : sessions) {
+        auto& releases = session.mArbiter->releases();
+        announced.push_back(&releases);
+        words.push_back(&releases.generation);
+        words.push_back(&session.mQueue->generation);
+        if (session.mLinkId >= 0 || session.mAccessMode == AccessMode::Shared || session.mHierarchy->inUse()) {
+          words.push_back(&session.mHierarchy->releases());
+        }
+      }
+      for (auto word : words) {
+        expected.push_back(word->load());
+      }
+
+      auto first = std::find_if(sessions.begin(), sessions.end(), [](Session& session) { return session.start(); });
+      if (first != sessions.end()) {
+        started = &*first;
+        break;
+      } else if (waiter.expired()) {
+        break;
       }
+
+      for (auto releases : announced) {
+        releases->waiters.fetch_add(1);
+      }
+      auto slice = std::min<std::chrono::nanoseconds>(std::chrono::milliseconds(waiter.remaining()), kAnySlice);
+      bool waited = futex::waitAny(words.data(), expected.data(), std::min<int>(words.size(), futex::kMaxWaitAny), slice);
+      for (auto releases : announced) {
+        releases->waiters.fetch_sub(1);
+      }
+      if (!waited) { // No futex_waitv; poll
+        waiter.pause();
+      }
+    }
+  } catch (...) {
+    leave();
+    throw;
+  }
+  leave();
+  return started;
+}
+
+void Session::stop()
+{
+  // In case of stop, wait for other threads starting or stopping the Session
+  State state = State::Started;
+  while (!mState.compare_exchange_weak(state, State::Stopping)) {
+    if (state == State::Stopped) {
+      return;
+    }
+    std::this_thread::yield();
+    state = State::Started;
+  }
+
+  // Released first, so that the Session stays started if the lock refuses, e.g. a mutex released
+  // by another thread than the one that took it
+  try {
+    if (mLeaseTime > 0) {
+      endLease();
     } else {
+      release(mBiasGracePeriod);
+    }
+  } catch (...) {
+    mState = State::Started;
+    throw;
+  }
+  chargeQuota();
+  WaitForGraph::get().remove(mGraphEntry);
+  mGraphEntry = -1;
+  mState = State::Stopped;
+}
+
+void Session::handOff(const std::string& recipient, int timeOut)
+{
+  if (recipient.size() > LockParameters::kMaxLockNameLength) {
+    BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("Recipient name too long: " + recipient));
+  } else if (mLinkId >= 0 || mAccessMode == AccessMode::Shared || mLeaseTime > 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Only Sessions locking a whole card or endpoint exclusively, without a lease, can hand off"));
+  }
+
+  State state = State::Started;
+  if (!mState.compare_exchange_strong(state, State::Stopping)) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Only started Sessions can hand off"));
+  } else if (!mArbiter->isReleasable()) {
+    mState = State::Started;
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("The lock of the card can only be released by the thread that took it"));
+  }
+
+  // Only the holder of the part writes its reservation; readers notice the generation change
+  auto& reservation = mHandoff->slots[mGranularity == LockGranularity::Endpoint ? 1 + mEndpoint : 0];
+  uint32_t generation = (reservation.word.load() & ~detail::Handoff::kStateMask) + detail::Handoff::kGeneration;
+  reservation.word.store(generation | detail::Handoff::Writing);
+  std::memcpy(reservation.recipient, recipient.c_str(), recipient.size() + 1);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+  reservation.deadline.store(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count());
+  reservation.word.store(generation | detail::Handoff::Reserved, std::memory_order_release);
+
+  // Without a grace period, as the card is meant for the recipient
+  chargeQuota();
+  WaitForGraph::get().remove(mGraphEntry);
+  mGraphEntry = -1;
+  release(0);
+  mState = State::Stopped;
+}
+
+bool Session::renew()
+{
+  if (mLeaseTime <= 0 || !isStarted()) {
+    return false;
+  }
+
+  auto& lease = mLease->slots[mGranularity == LockGranularity::Endpoint ? 1 + mEndpoint : 0];
+  auto state = lease.state.load();
+  while (detail::Lease::held(state) && detail::Lease::generation(state) == mLeaseGeneration) {
+    if (lease.state.compare_exchange_weak(state, detail::Lease::makeState(mLeaseGeneration, true, detail::Lease::now() + mLeaseTime))) {
       return true;
     }
   }
 
+  // Revoked; there's nothing left to release
+  State started = State::Started;
+  if (mState.compare_exchange_strong(started, State::Stopping)) {
+    chargeQuota();
+    WaitForGraph::get().remove(mGraphEntry);
+    mGraphEntry = -1;
+    mState = State::Stopped;
+  }
   return false;
 }
 
-void Session::stop()
+uint32_t Session::getLeaseGeneration() const
+{
+  return mLeaseGeneration;
+}
+
+bool Session::isYieldRequested()
 {
-  // In case of stop, block until mutex acquired
-  std::unique_lock<std::mutex> ul(mMutex);
-  
-  if (isStarted()) {
-    mLock->unlock();
-    mIsStarted = false;
+  auto& queue = *mQueue;
+  if (queue.length.load(std::memory_order_relaxed) == 0 || mState != State::Started) {
+    return false;
   }
+
+  // Nothing new since the last scan found no request; waiters leaving only withdraw theirs
+  const uint32_t requests = queue.yieldRequests.load();
+  if (mYieldScanned.load(std::memory_order_relaxed) == requests) {
+    return false;
+  }
+
+  // Only waiters of higher priority for parts of the card the Session holds
+  const auto graphScope = makeGraphScope(scope(), mAccessMode);
+  for (int i = 0; i < detail::WaitQueue::kMaxEntries; ++i) {
+    auto& entry = queue.entries[i];
+    int32_t pid = entry.pid.load(std::memory_order_acquire);
+    if (pid > 0 && entry.yieldDeadline.load(std::memory_order_relaxed) != 0 && !entry.aside.load(std::memory_order_relaxed) &&
+        entry.priority > mPriority && WaitForGraph::conflict(entry.scope, graphScope) && isAlive(pid)) {
+      return true;
+    }
+  }
+  mYieldScanned.store(requests, std::memory_order_relaxed);
+  return false;
 }
 
-bool Session::isStarted()
+int Session::getSlotTimeLeft() const
 {
-  return mIsStarted;
+  const auto schedule = mSchedule->get();
+  if (schedule.size() == 0) {
+    return -1;
+  }
+  std::chrono::nanoseconds wait;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(slotTimeLeft(schedule, mClientClass, wait)).count();
 }
 
-void Session::makeLockName()
+bool Session::isStarted()
 {
-  std::stringstream ss;
-  ss << "_CRU_" << mCardId << "_lla_lock";
-  mLockParams = LockParameters::makeParameters()
-                  .setLockName(ss.str());
+  return mState == State::Started;
 }
 
 } // namespace lla
@@ -0,0 +1,142 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SessionGroup.cxx
+/// \brief Implementation of the SessionGroup class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <algorithm>
+#include <string>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+#include "Lla/SessionGroup.h"
+
+#include "WaitForGraph.h"
+#include "Waiter.h"
+
+namespace o2
+{
+namespace lla
+{
+
+SessionGroup::SessionGroup(const std::vector<SessionParameters>& params)
+{
+  mSessions.reserve(params.size());
+  for (const auto& sessionParams : params) {
+    SessionParameters copy(sessionParams);
+    mSessions.emplace_back(new Session(copy));
+  }
+
+  auto byScope = [](const std::unique_ptr<Session>& a, const std::unique_ptr<Session>& b) {
+    return a->scope() < b->scope();
+  };
+  std::sort(mSessions.begin(), mSessions.end(), byScope);
+
+  // Sessions whose scopes overlap, e.g. a whole card and one of its links, would wait for each other
+  auto graphScope = [](const Session& session) {
+    auto scope = session.scope();
+    return WaitForGraph::Scope{ std::get<0>(scope), std::get<1>(scope), std::get<2>(scope), std::get<3>(scope), session.mAccessMode == AccessMode::Shared };
+  };
+  for (std::size_t i = 0; i < mSessions.size(); ++i) {
+    for (std::size_t j = i + 1; j < mSessions.size(); ++j) {
+      if (mSessions[i]->scope() == mSessions[j]->scope() || WaitForGraph::conflict(graphScope(*mSessions[i]), graphScope(*mSessions[j]))) {
+        BOOST_THROW_EXCEPTION(ParameterException() << ErrorInfo::Message("SessionGroup has two Sessions on overlapping parts of card " + std::to_string(mSessions[i]->mSerial)));
+      }
+    }
+  }
+}
+
+/* Make sure that the sessions are stopped, so the locks are released */
+SessionGroup::~SessionGroup()
+{
+  stop();
+}
+
+bool SessionGroup::start()
+{
+  if (mStarted) {
+    return true;
+  }
+  mStarted = acquire(nullptr);
+  return mStarted;
+}
+
+bool SessionGroup::timedStart(int timeOut)
+{
+  if (mStarted) {
+    return true;
+  }
+  Waiter waiter(WaitStrategy::Park, timeOut);
+  mStarted = acquire(&waiter);
+  return mStarted;
+}
+
+void SessionGroup::stop()
+{
+  if (mStarted) {
+    stopFrom(0);
+    mStarted = false;
+  }
+}
+
+bool SessionGroup::isStarted() const
+{
+  return mStarted;
+}
+
+std::size_t SessionGroup::size() const
+{
+  return mSessions.size();
+}
+
+/// Starts all the Sessions, or none, within the deadline of the waiter if any
+bool SessionGroup::acquire(Waiter* waiter)
+{
+  try {
+    // Uncontended, a single round of attempts. Waiting only while holding the Sessions that come
+    // before the busy one is what keeps overlapping groups from deadlocking
+    auto busy = startFrom(0);
+    while (busy < mSessions.size()) {
+      if (!waiter || !mSessions[busy]->timedStart(waiter->remaining())) {
+        stopFrom(0);
+        return false;
+      }
+      busy = startFrom(busy + 1);
+    }
+  } catch (...) {
+    stopFrom(0);
+    throw;
+  }
+  return true;
+}
+
+std::size_t SessionGroup::startFrom(std::size_t first)
+{
+  for (auto i = first; i < mSessions.size(); ++i) {
+    if (!mSessions[i]->start()) {
+      return i;
+    }
+  }
+  return mSessions.size();
+}
+
+void SessionGroup::stopFrom(std::size_t first)
+{
+  for (auto i = mSessions.size(); i-- > first;) {
+    mSessions[i]->stop();
+  }
+}
+
+} // namespace lla
+} // namespace o2
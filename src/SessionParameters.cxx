@@ -16,7 +16,6 @@
 /// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
 
 #include <boost/throw_exception.hpp>
-#include <map>
 #include "Lla/SessionParameters.h"
 #include "Lla/Exception.h"
 
@@ -25,41 +24,13 @@ namespace o2
 namespace lla
 {
 
-using Variant = boost::variant<std::string, int, SessionParameters::CardIdType>;
-using KeyType = const char*;
-using Map = std::map<KeyType, Variant>;
-
-struct ParametersPimpl {
-  Map map;
-};
-
 namespace
 {
-
-template <typename T>
-void setParam(Map& map, KeyType key, const T& value)
-{
-  map[key] = Variant{ value };
-}
-
-template <typename T>
-auto getParam(const Map& map, KeyType key) -> boost::optional<T>
-{
-  auto it = map.find(key);
-  if (it != map.end()) {
-    auto var = it->second;
-    auto val = boost::get<T>(var);
-    return val;
-  } else {
-    return boost::none;
-  }
-}
-
 template <typename T>
-auto getParamRequired(const Map& map, KeyType key) -> T
+auto getParamRequired(const boost::optional<T>& param, const char* key) -> T
 {
-  if (auto optional = getParam<T>(map, key)) {
-    return *optional;
+  if (param) {
+    return *param;
   } else {
     BOOST_THROW_EXCEPTION(ParameterException()
                           << ErrorInfo::Message("Parameter was not set")
@@ -71,66 +42,45 @@ auto getParamRequired(const Map& map, KeyType key) -> T
 #define _PARAMETER_FUNCTIONS(_param_name, _key_string)                                  \
   auto SessionParameters::set##_param_name(_param_name##Type value)->SessionParameters& \
   {                                                                                     \
-    setParam(mPimpl->map, _key_string, value);                                          \
+    m##_param_name = std::move(value);                                                  \
     return *this;                                                                       \
   }                                                                                     \
                                                                                         \
   auto SessionParameters::get##_param_name() const->boost::optional<_param_name##Type>  \
   {                                                                                     \
-    return getParam<_param_name##Type>(mPimpl->map, _key_string);                       \
+    return m##_param_name;                                                              \
   }                                                                                     \
                                                                                         \
   auto SessionParameters::get##_param_name##Required() const->_param_name##Type         \
   {                                                                                     \
-    return getParamRequired<_param_name##Type>(mPimpl->map, _key_string);               \
+    return getParamRequired(m##_param_name, _key_string);                               \
   }
 
 _PARAMETER_FUNCTIONS(SessionName, "session_name")
 _PARAMETER_FUNCTIONS(CardId, "card_id")
+_PARAMETER_FUNCTIONS(WaitStrategy, "wait_strategy")
+_PARAMETER_FUNCTIONS(BiasGracePeriod, "bias_grace_period")
+_PARAMETER_FUNCTIONS(Reentrant, "reentrant")
+_PARAMETER_FUNCTIONS(LockType, "lock_type")
+_PARAMETER_FUNCTIONS(LockGranularity, "lock_granularity")
+_PARAMETER_FUNCTIONS(LinkId, "link_id")
+_PARAMETER_FUNCTIONS(RegisterGroup, "register_group")
+_PARAMETER_FUNCTIONS(AccessMode, "access_mode")
+_PARAMETER_FUNCTIONS(LeaseTime, "lease_time")
+_PARAMETER_FUNCTIONS(Priority, "priority")
+_PARAMETER_FUNCTIONS(PreemptTimeOut, "preempt_timeout")
+_PARAMETER_FUNCTIONS(ClientClass, "client_class")
+_PARAMETER_FUNCTIONS(HoldQuota, "hold_quota")
+_PARAMETER_FUNCTIONS(Schedule, "schedule")
 
 #undef _PARAMETER_FUNCTIONS
 
-SessionParameters::SessionParameters() : mPimpl(std::make_unique<ParametersPimpl>())
-{
-}
-
-SessionParameters::SessionParameters(const SessionParameters& other)
-{
-  mPimpl = std::make_unique<ParametersPimpl>();
-  mPimpl->map = other.mPimpl->map;
-}
-
-SessionParameters::SessionParameters(SessionParameters&& other)
-{
-  mPimpl = std::move(other.mPimpl);
-}
-
-SessionParameters::~SessionParameters()
-{
-}
-
-SessionParameters& SessionParameters::operator=(const SessionParameters& other)
-{
-  if (&other == this) {
-    return *this;
-  }
-
-  if (!mPimpl) {
-    mPimpl = std::make_unique<ParametersPimpl>();
-  }
-  mPimpl->map = other.mPimpl->map;
-  return *this;
-}
-
-SessionParameters& SessionParameters::operator=(SessionParameters&& other)
-{
-  if (&other == this) {
-    return *this;
-  }
-
-  mPimpl = std::move(other.mPimpl);
-  return *this;
-}
+SessionParameters::SessionParameters() = default;
+SessionParameters::SessionParameters(const SessionParameters& other) = default;
+SessionParameters::SessionParameters(SessionParameters&& other) = default;
+SessionParameters::~SessionParameters() = default;
+SessionParameters& SessionParameters::operator=(const SessionParameters& other) = default;
+SessionParameters& SessionParameters::operator=(SessionParameters&& other) = default;
 
 } // namespace lla
 } // namespace o2
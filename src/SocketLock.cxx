@@ -16,108 +16,248 @@
 /// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
 
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
+#include <thread>
 #include <fcntl.h>
+#include <poll.h>
 #include <boost/throw_exception.hpp>
 
 #include "Lla/Exception.h"
-#include "SocketLock.h"
+#include "Lla/Locks/SocketLock.h"
 
 namespace o2
 {
 namespace lla
 {
 
+namespace
+{
+// How long a new holder retries binding the wait socket, which the previous holder closes right
+// after releasing the lock
+constexpr std::chrono::milliseconds kRebindPeriod(1);
+
+/// \return true if the peer of the connection closed it
+bool isClosed(int fd)
+{
+  char byte;
+  return recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+} // anonymous namespace
+
 SocketLock::SocketLock(const LockParameters& params)
   : InterprocessLockBase(params)
 {
-  memset(&mServerAddress, 0, sizeof(mServerAddress));
-  mServerAddress.sun_family = AF_UNIX;
-
-  // Care in case the filename is longer than the unix socket name length
-  mSafeSocketLockName = hashSocketLockName();
-  strcpy(mServerAddress.sun_path, mSafeSocketLockName.c_str());
-  mServerAddress.sun_path[0] = 0; //this makes the unix domain socket *abstract*
+  // LockParameters shortens long names, so that they fit the socket addresses
+  static_assert(LockParameters::kMaxLockNameLength + sizeof("_wait") <= sizeof(sockaddr_un::sun_path),
+                "Lock names have to fit the socket addresses");
+  mSafeSocketLockName = mLockName;
+  mSafeWaitName = mLockName + "_wait";
+  makeAbstractAddress(mServerAddress, mSafeSocketLockName);
+  makeAbstractAddress(mWaitAddress, mSafeWaitName);
 }
 
 SocketLock::~SocketLock()
 {
   unlock();
+  if (mSocketFd >= 0) { // Left over from a failed attempt
+    close(mSocketFd);
+  }
 }
 
-void SocketLock::lock()
+LockStatus::Type SocketLock::tryAcquire()
 {
-  if (!mLocked) {
-    if ((mSocketFd = socket(AF_UNIX, SOCK_DGRAM, 0)) < 0) {
-      BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't create abstract socket fd for InterprocessLock"));
-    }
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  }
 
-    if (bind(mSocketFd,
-             (const struct sockaddr*)&mServerAddress,
-             mAddressLength) < 0) {
-      close(mSocketFd);
-      BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't bind to socket " + mSafeSocketLockName));
-    }
+  // The socket is kept across failed attempts; a failed bind() leaves it unbound and reusable
+  if (mSocketFd < 0 && (mSocketFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't create abstract socket fd for InterprocessLock"));
+  }
 
-    mLocked = true;
-  } else {
-    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Already locked " + mSafeSocketLockName));
+  if (bind(mSocketFd,
+           (const struct sockaddr*)&mServerAddress,
+           mAddressLength) < 0) {
+    if (errno == EADDRINUSE) {
+      return LockStatus::Busy;
+    }
+    int error = errno;
+    close(mSocketFd);
+    mSocketFd = -1;
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't bind to socket " + mSafeSocketLockName + ": " + strerror(error)));
   }
-}
 
-bool SocketLock::tryLock()
-{
-  try {
-    lock();
-    return true;
-  } catch (const LlaException& e) {
-    // DEBUG
-    //std::cerr << e.what() << std::endl;
-  }
-  return false;
+  mLocked = true;
+  listenForWaiters(kRebindPeriod);
+  return LockStatus::Acquired;
 }
 
-bool SocketLock::timedLock(int timeOut)
+LockStatus::Type SocketLock::timedAcquire(int timeOut)
 {
+  if (mWaitStrategy != WaitStrategy::Park) {
+    return retryLock(timeOut);
+  }
+
   const auto start = std::chrono::steady_clock::now();
-  auto timeExceeded = [&]() { return ((std::chrono::steady_clock::now() - start) > std::chrono::milliseconds(timeOut)); };
+  auto remaining = [&]() { return std::chrono::duration_cast<std::chrono::milliseconds>(start + std::chrono::milliseconds(timeOut) - std::chrono::steady_clock::now()).count(); };
 
-  while (!timeExceeded()) {
-    if (tryLock()) {
-      return true;
+  if (mHadWaiters) {
+    deferToWaiters(remaining());
+  }
+
+  bool retried = false;
+  LockStatus::Type status;
+  while ((status = tryAcquire()) == LockStatus::Busy) {
+    if (remaining() <= 0) {
+      return LockStatus::TimedOut;
+    }
+
+    if (waitForRelease(remaining())) {
+      retried = false;
+    } else if (!retried) { // The holder may have just released; retry once right away
+      retried = true;
+    } else { // The holder isn't listening (yet); fall back to a short sleep
+      std::this_thread::sleep_for(std::chrono::milliseconds(std::min(1L, (long)remaining())));
     }
   }
 
-  return false;
+  return status;
 }
 
 void SocketLock::unlock()
 {
-  if (mLocked && fcntl(mSocketFd, F_GETFD) != -1) { // Close the socket fd in case it is still open
+  if (mLocked) {
     close(mSocketFd);
+    mSocketFd = -1;
     mLocked = false;
+
+    // Closing the wait socket, and the connections of the waiters, after the lock wakes them up
+    mHadWaiters = mWaitFd != -1 && hasWaiters();
+    if (mWaitFd != -1) {
+      close(mWaitFd);
+      mWaitFd = -1;
+    }
+    for (int fd : mWaiterFds) {
+      close(fd);
+    }
+    mWaiterFds.clear();
+  }
+}
+
+/// Waiters connecting to the wait socket make it readable
+bool SocketLock::waitForContention(int timeOut)
+{
+  if (mLocked && mWaitFd == -1) {
+    listenForWaiters(std::chrono::milliseconds(0)); // Still held by the previous holder when locking
+  }
+  if (!mLocked || mWaitFd == -1) {
+    return InterprocessLockBase::waitForContention(timeOut);
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+  while (!hasWaiters()) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    struct pollfd pfd = { mWaitFd, POLLIN, 0 };
+    if (left <= 0 || poll(&pfd, 1, left) <= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Listens on the wait socket, for waiters to connect to; best effort
+/// \param patience How long to retry, while the previous holder still has the wait socket
+void SocketLock::listenForWaiters(std::chrono::milliseconds patience)
+{
+  mWaitFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (mWaitFd < 0) {
+    return;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + patience;
+  while (bind(mWaitFd, (const struct sockaddr*)&mWaitAddress, mAddressLength) < 0) {
+    if (errno != EADDRINUSE || std::chrono::steady_clock::now() >= deadline) {
+      close(mWaitFd);
+      mWaitFd = -1;
+      return;
+    }
+    std::this_thread::yield();
+  }
+  if (listen(mWaitFd, SOMAXCONN) < 0) {
+    close(mWaitFd);
+    mWaitFd = -1;
   }
 }
 
-std::string SocketLock::hashSocketLockName()
+/// Accepts the pending connections to the wait socket, and drops those of waiters that gave up
+/// \return true if a waiter is still connected
+bool SocketLock::hasWaiters()
 {
-  if (mLockName.length() >= UNIX_SOCK_NAME_LENGTH) { // TODO: FRED-DDT LLA never uses this part, could be used for RoC as well
-    std::string lockType = mLockName.substr(0, 17);  // isolate the class that created the lock
+  int fd;
+  while ((fd = accept4(mWaitFd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+    mWaiterFds.push_back(fd);
+  }
+  auto gone = std::remove_if(mWaiterFds.begin(), mWaiterFds.end(), [](int fd) {
+    if (isClosed(fd)) {
+      close(fd);
+      return true;
+    }
+    return false;
+  });
+  mWaiterFds.erase(gone, mWaiterFds.end());
+  return !mWaiterFds.empty();
+}
+
+/// Sleeps until the current holder closes its wait socket, or the timeout expires
+/// \return true if the wait socket was reached, false if nobody was listening on it
+bool SocketLock::waitForRelease(int timeOut)
+{
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
 
-    unsigned long lockNameHash = hashDjb2(mLockName.c_str(), mLockName.size());   // hash the mutable part
-    std::string safeLockName = lockType + std::to_string(lockNameHash) + "_lock"; // return conformant name
-    return safeLockName;
-  } else {
-    return mLockName;
+  if (connect(fd, (const struct sockaddr*)&mWaitAddress, mAddressLength) < 0) {
+    close(fd);
+    return false;
+  }
+
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  poll(&pfd, 1, timeOut);
+  close(fd);
+  return true;
+}
+
+/// Gives the waiters woken up by our last unlock a short head start, so that we don't barge in
+/// ahead of them by re-locking straight away
+void SocketLock::deferToWaiters(int timeOut)
+{
+  mHadWaiters = false;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::min(timeOut, 1));
+  while (std::chrono::steady_clock::now() < deadline) {
+    // A datagram connect() only tells whether the lock socket is bound, without leaving a
+    // connection in the new holder's wait socket backlog
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    bool taken = fd >= 0 && connect(fd, (const struct sockaddr*)&mServerAddress, mAddressLength) == 0;
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (taken) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
   }
 }
 
-unsigned long SocketLock::hashDjb2(const char* str, size_t length)
+void SocketLock::makeAbstractAddress(struct sockaddr_un& address, const std::string& name)
 {
-  unsigned long hash = 5381;
-  for (size_t i = 0; i < length; ++i)
-    hash = 33 * hash + (unsigned char)str[i];
-  return hash;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, name.c_str());
+  address.sun_path[0] = 0; //this makes the unix domain socket *abstract*
 }
 
 } // namespace lla
@@ -0,0 +1,179 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TicketLock.cxx
+/// \brief Implementation of the TicketLock class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <cerrno>
+#include <chrono>
+#include <signal.h>
+#include <unistd.h>
+
+#include "Lla/Locks/Futex.h"
+#include "Lla/Locks/TicketLock.h"
+#include "Waiter.h"
+
+namespace o2
+{
+namespace lla
+{
+
+namespace
+{
+// States of a ticket slot
+enum : uint32_t {
+  Waiting = 0,
+  Granted = 1,
+  Abandoned = 2
+};
+
+inline uint32_t slotIndex(uint32_t ticket)
+{
+  return ticket % TICKET_LOCK_SLOTS;
+}
+
+inline bool isDead(pid_t pid)
+{
+  return pid != 0 && kill(pid, 0) == -1 && errno == ESRCH;
+}
+} // anonymous namespace
+
+TicketLock::TicketLock(const LockParameters& params)
+  : InterprocessLockBase(params),
+    mShared(mLockName + "_ticket", [](TicketQueue& queue) { queue.slots[0].store(Granted); })
+{
+}
+
+TicketLock::~TicketLock()
+{
+  unlock();
+}
+
+LockStatus::Type TicketLock::tryAcquire()
+{
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  }
+
+  // Only take a ticket if it's immediately served
+  uint32_t ticket = mShared->next.load();
+  auto& slot = mShared->slots[slotIndex(ticket)];
+  if (mShared->owner.load() != ticket || slot.load() != Granted) {
+    return LockStatus::Busy;
+  }
+  if (!mShared->next.compare_exchange_strong(ticket, ticket + 1)) {
+    return LockStatus::Busy;
+  }
+
+  slot.store(Waiting);
+  mTicket = ticket;
+  mLocked = true;
+  return LockStatus::Acquired;
+}
+
+LockStatus::Type TicketLock::timedAcquire(int timeOut)
+{
+  if (mLocked) {
+    return LockStatus::AlreadyLocked;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut);
+  Waiter waiter(mWaitStrategy, timeOut);
+
+  // No more tickets are out than there are slots, abandoned ones included until the holder skips
+  // them, so that a slot only ever holds the state of one ticket
+  uint32_t ticket = mShared->next.load();
+  while (ticket - mShared->owner.load() >= TICKET_LOCK_SLOTS || !mShared->next.compare_exchange_weak(ticket, ticket + 1)) {
+    if (ticket - mShared->owner.load() >= TICKET_LOCK_SLOTS) {
+      if (!waiter.pause()) {
+        return LockStatus::TimedOut;
+      }
+      ticket = mShared->next.load();
+    }
+  }
+  auto& slot = mShared->slots[slotIndex(ticket)];
+  auto& pid = mShared->pids[slotIndex(ticket)];
+  pid.store(getpid());
+  if (ticket == mShared->owner.load() + 1) { // First in line; wake up a holder waiting for contention
+    futex::wake(&mShared->next);
+  }
+
+  while (true) {
+    if (slot.load() == Granted) {
+      break;
+    }
+
+    auto remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::nanoseconds(0)) {
+      pid.store(0);
+      uint32_t expected = Waiting;
+      if (slot.compare_exchange_strong(expected, Abandoned)) {
+        return LockStatus::TimedOut;
+      }
+      break; // Granted just in time; the slot is this ticket's alone
+    }
+    if (mWaitStrategy == WaitStrategy::Park) {
+      futex::wait(&slot, Waiting, remaining);
+    } else {
+      waiter.pause();
+    }
+  }
+
+  pid.store(0);
+  slot.store(Waiting);
+  mTicket = ticket;
+  mLocked = true;
+  return LockStatus::Acquired;
+}
+
+bool TicketLock::waitForContention(int timeOut)
+{
+  if (!mLocked) {
+    return false;
+  }
+
+  // Any ticket handed out after ours is a waiter
+  futex::wait(&mShared->next, mTicket + 1, std::chrono::milliseconds(timeOut));
+  return mShared->next.load() != mTicket + 1;
+}
+
+void TicketLock::unlock()
+{
+  if (!mLocked) {
+    return;
+  }
+  mLocked = false;
+
+  // Grant the lock to the next live ticket, skipping abandoned ones
+  for (uint32_t ticket = mTicket + 1;; ticket++) {
+    mShared->owner.store(ticket);
+    auto& slot = mShared->slots[slotIndex(ticket)];
+    auto& pid = mShared->pids[slotIndex(ticket)];
+
+    if (isDead(pid.load())) {
+      pid.store(0);
+      continue;
+    }
+
+    uint32_t expected = Waiting;
+    if (slot.compare_exchange_strong(expected, Granted)) {
+      futex::wake(&slot);
+      return;
+    }
+    slot.store(Waiting); // Abandoned; make it reusable
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,211 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file WaitForGraph.cxx
+/// \brief Implementation of the WaitForGraph class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <boost/throw_exception.hpp>
+
+#include "Lla/Exception.h"
+#include "WaitForGraph.h"
+
+namespace o2
+{
+namespace lla
+{
+
+constexpr int WaitForGraph::kMaxEntries;
+
+namespace
+{
+using Thread = std::pair<int32_t, int32_t>; // pid, tid
+
+bool isAlive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+int32_t threadId()
+{
+  thread_local int32_t tid = syscall(SYS_gettid);
+  return tid;
+}
+} // anonymous namespace
+
+bool WaitForGraph::conflict(const Scope& a, const Scope& b)
+{
+  if (a.serial != b.serial || (a.shared && b.shared)) {
+    return false;
+  }
+  const int levelsA[] = { a.endpoint, a.link, a.registerGroup };
+  const int levelsB[] = { b.endpoint, b.link, b.registerGroup };
+  for (int level = 0; level < 3; ++level) {
+    if (levelsA[level] < 0 || levelsB[level] < 0) {
+      return true;
+    } else if (levelsA[level] != levelsB[level]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+WaitForGraph& WaitForGraph::get()
+{
+  static WaitForGraph graph;
+  return graph;
+}
+
+WaitForGraph::WaitForGraph()
+  : mShared("lla_wait_for_graph", initTable)
+{
+}
+
+void WaitForGraph::initTable(Table& table)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&table.mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+int WaitForGraph::hold(const Scope& scope)
+{
+  return claim(scope, scope.shared ? Shared : 0);
+}
+
+int WaitForGraph::wait(const Scope& scope)
+{
+  lockTable();
+  int entry = claim(scope, Waiting | (scope.shared ? Shared : 0));
+  bool deadlock = entry >= 0 && closesCycle(entry);
+  if (deadlock) {
+    remove(entry);
+  }
+  pthread_mutex_unlock(&mShared->mutex);
+
+  if (deadlock) {
+    BOOST_THROW_EXCEPTION(DeadlockException() << ErrorInfo::Message("Waiting for card " + std::to_string(scope.serial) + " would deadlock with the Sessions holding it"));
+  }
+  return entry;
+}
+
+void WaitForGraph::remove(int entry)
+{
+  if (entry >= 0) {
+    mShared->entries[entry].pid.store(0, std::memory_order_release);
+  }
+}
+
+/// Takes a free entry and fills it in for the calling thread
+int WaitForGraph::claim(const Scope& scope, uint8_t flags)
+{
+  // Threads tend to take the entry they freed last
+  thread_local int hint = 0;
+  auto& entries = mShared->entries;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int n = 0; n < kMaxEntries; ++n) {
+      int i = (hint + n) % kMaxEntries;
+      int32_t free = 0;
+      if (entries[i].pid.load(std::memory_order_relaxed) == 0 && entries[i].pid.compare_exchange_strong(free, -1)) {
+        entries[i].tid = threadId();
+        entries[i].serial = scope.serial;
+        entries[i].endpoint = scope.endpoint;
+        entries[i].link = scope.link;
+        entries[i].registerGroup = scope.registerGroup;
+        entries[i].flags = flags;
+        entries[i].pid.store(getpid(), std::memory_order_release);
+        hint = i;
+        return i;
+      }
+    }
+
+    // Full; reclaim the entries of processes that died
+    for (auto& entry : entries) {
+      int32_t pid = entry.pid.load();
+      if (pid > 0 && !isAlive(pid)) {
+        entry.pid.compare_exchange_strong(pid, 0);
+      }
+    }
+  }
+  return -1;
+}
+
+/// Follows the holders of what the waiting entry waits for, what they wait for, and so on
+/// Threads waiting for what they hold themselves are left to time out, as before.
+bool WaitForGraph::closesCycle(int entry)
+{
+  struct Node {
+    Thread thread;
+    Scope scope;
+  };
+  std::vector<Node> holds;
+  std::vector<Node> waits;
+  for (auto& e : mShared->entries) {
+    int32_t pid = e.pid.load(std::memory_order_acquire);
+    if (pid > 0) {
+      Node node{ { pid, e.tid }, { e.serial, e.endpoint, e.link, e.registerGroup, bool(e.flags & Shared) } };
+      (e.flags & Waiting ? waits : holds).push_back(node);
+    }
+  }
+
+  const auto& own = mShared->entries[entry];
+  const Thread self(getpid(), own.tid);
+  std::vector<Thread> visited{ self };
+  std::vector<std::pair<Thread, Scope>> frontier{ { self, Scope{ own.serial, own.endpoint, own.link, own.registerGroup, bool(own.flags & Shared) } } };
+  while (!frontier.empty()) {
+    auto waiter = frontier.back();
+    frontier.pop_back();
+    for (const auto& hold : holds) {
+      if (hold.thread == waiter.first || !conflict(hold.scope, waiter.second)) {
+        continue;
+      } else if (hold.thread == self) {
+        return true;
+      } else if (std::find(visited.begin(), visited.end(), hold.thread) != visited.end() || !isAlive(hold.thread.first)) {
+        continue;
+      }
+      visited.push_back(hold.thread);
+      for (const auto& wait : waits) {
+        if (wait.thread == hold.thread) {
+          frontier.emplace_back(wait.thread, wait.scope);
+        }
+      }
+    }
+  }
+  return false;
+}
+
+void WaitForGraph::lockTable()
+{
+  int result = pthread_mutex_lock(&mShared->mutex);
+  if (result == EOWNERDEAD) {
+    // Checks don't modify other entries, so the table is consistent as is
+    pthread_mutex_consistent(&mShared->mutex);
+  } else if (result != 0) {
+    BOOST_THROW_EXCEPTION(LlaException() << ErrorInfo::Message("Couldn't lock the wait-for graph: " + std::string(strerror(result))));
+  }
+}
+
+} // namespace lla
+} // namespace o2
@@ -0,0 +1,103 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file WaitForGraph.h
+/// \brief Definition of the WaitForGraph class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_WAITFORGRAPH_H
+#define O2_LLA_SRC_WAITFORGRAPH_H
+
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+
+#include "Lla/Locks/SharedMemory.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Host-wide graph of the threads holding and waiting for parts of cards, in shared memory
+///
+/// Started Sessions record what they hold, without locking; timed starts record what they wait
+/// for, and look for cycles, under a robust mutex. Threads record their holds before they wait
+/// again, so a cycle is always closed by a new wait: the thread recording it is the youngest
+/// waiter of the cycle, and the one to fail. Entries of processes that died are ignored.
+class WaitForGraph
+{
+ public:
+  /// Part of a card, as in LockHierarchy::Node; unset levels are -1
+  struct Scope {
+    int serial;
+    int endpoint;
+    int link;
+    int registerGroup;
+    bool shared;
+  };
+
+  /// \return Whether the scopes overlap, and the Sessions holding them exclude each other
+  static bool conflict(const Scope& a, const Scope& b);
+
+  /// \return The graph of the host, mapped once per process
+  static WaitForGraph& get();
+
+  /// Records that the calling thread holds the scope
+  /// \return The entry, for remove(); -1 if the graph is full, and the hold goes unrecorded
+  int hold(const Scope& scope);
+
+  /// Records that the calling thread waits for the scope
+  /// \return The entry, for remove(); -1 if the graph is full, and the wait goes unchecked
+  /// \throws o2::lla::DeadlockException if the holders of the scope wait for the calling thread,
+  /// directly or not
+  int wait(const Scope& scope);
+
+  void remove(int entry);
+
+ private:
+  static constexpr int kMaxEntries = 512;
+
+  enum Flags : uint8_t {
+    Waiting = 1,
+    Shared = 2
+  };
+
+  struct Entry {
+    std::atomic<int32_t> pid; // 0 for a free entry, -1 while it's being written
+    int32_t tid;
+    int32_t serial;
+    int8_t endpoint;
+    int8_t link;
+    int8_t registerGroup;
+    uint8_t flags;
+  };
+
+  struct Table {
+    pthread_mutex_t mutex;
+    Entry entries[kMaxEntries];
+  };
+
+  WaitForGraph();
+  static void initTable(Table& table);
+  int claim(const Scope& scope, uint8_t flags);
+  bool closesCycle(int entry);
+  void lockTable();
+
+  SharedMemory<Table> mShared;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_WAITFORGRAPH_H
@@ -0,0 +1,103 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Waiter.cxx
+/// \brief Implementation of the Waiter class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+#include "Waiter.h"
+
+namespace o2
+{
+namespace lla
+{
+
+namespace
+{
+constexpr int kSpinsBeforeYield = 100;
+constexpr std::chrono::microseconds kMinBackoff(1);
+constexpr std::chrono::microseconds kMaxBackoff(1000);
+constexpr std::chrono::microseconds kParkSlice(1000);
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+} // anonymous namespace
+
+Waiter::Waiter(WaitStrategy::Type strategy, int timeOut)
+  : mStrategy(strategy),
+    mDeadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOut)),
+    mBackoff(kMinBackoff)
+{
+}
+
+bool Waiter::pause()
+{
+  auto now = std::chrono::steady_clock::now();
+  if (now >= mDeadline) {
+    return false;
+  }
+  auto left = std::chrono::duration_cast<std::chrono::microseconds>(mDeadline - now);
+
+  switch (mStrategy) {
+    case WaitStrategy::Spin:
+      cpuRelax();
+      break;
+    case WaitStrategy::SpinYield:
+      if (mAttempts < kSpinsBeforeYield) {
+        cpuRelax();
+      } else {
+        std::this_thread::yield();
+      }
+      break;
+    case WaitStrategy::Backoff: {
+      // Full jitter, so that waiters backing off together don't retry in lockstep
+      thread_local std::minstd_rand generator(std::random_device{}());
+      std::uniform_int_distribution<long> jitter(kMinBackoff.count(), mBackoff.count());
+      std::this_thread::sleep_for(std::min(left, std::chrono::microseconds(jitter(generator))));
+      mBackoff = std::min(mBackoff * 2, kMaxBackoff);
+      break;
+    }
+    case WaitStrategy::Park:
+    default:
+      std::this_thread::sleep_for(std::min(left, kParkSlice));
+      break;
+  }
+
+  mAttempts++;
+  return true;
+}
+
+int Waiter::remaining() const
+{
+  auto left = mDeadline - std::chrono::steady_clock::now();
+  if (left <= std::chrono::nanoseconds(0)) {
+    return 0;
+  }
+  return std::chrono::duration_cast<std::chrono::milliseconds>(left + std::chrono::microseconds(999)).count();
+}
+
+bool Waiter::expired() const
+{
+  return std::chrono::steady_clock::now() >= mDeadline;
+}
+
+} // namespace lla
+} // namespace o2
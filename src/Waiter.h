@@ -0,0 +1,55 @@
+
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Waiter.h
+/// \brief Definition of the Waiter class.
+///
+/// \author Kostas Alexopoulos (kostas.alexopoulos@cern.ch)
+
+#ifndef O2_LLA_SRC_WAITER_H
+#define O2_LLA_SRC_WAITER_H
+
+#include <chrono>
+
+#include "Lla/ParameterTypes/WaitStrategy.h"
+
+namespace o2
+{
+namespace lla
+{
+
+/// Paces the attempts of a timed acquisition according to a WaitStrategy, until a deadline
+class Waiter
+{
+ public:
+  Waiter(WaitStrategy::Type strategy, int timeOut);
+
+  /// Waits before the next attempt
+  /// \return false if the deadline has passed, true otherwise
+  bool pause();
+
+  /// \return Time left until the deadline, in ms, rounded up
+  int remaining() const;
+
+  bool expired() const;
+
+ private:
+  WaitStrategy::Type mStrategy;
+  std::chrono::steady_clock::time_point mDeadline;
+  int mAttempts = 0;
+  std::chrono::microseconds mBackoff;
+};
+
+} // namespace lla
+} // namespace o2
+
+#endif // O2_LLA_SRC_WAITER_H
@@ -20,12 +20,19 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 #include <assert.h>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <Lla/Exception.h>
+#include <Lla/Locks/TicketLock.h>
 #include <InterprocessLockFactory.h>
 
 using namespace o2::lla;
@@ -34,10 +41,39 @@ BOOST_AUTO_TEST_SUITE(LowLevelArbitration)
 
 BOOST_AUTO_TEST_CASE(LockFactoryFails)
 {
-  auto params = LockParameters::makeParameters(LockType::Type::FileLock);
+  auto params = LockParameters::makeParameters(static_cast<LockType::Type>(-1));
   BOOST_CHECK_THROW(InterprocessLockFactory::getInterprocessLock(params), LlaException);
 }
 
+BOOST_AUTO_TEST_CASE(CardLockNamesReserved)
+{
+  // Sessions may hold the card while its lock is free, so only they take it
+  BOOST_CHECK_THROW(LockParameters::makeParameters().setLockName("_CRU_3_lla_lock"), ParameterException);
+  BOOST_CHECK_THROW(LockParameters::makeParameters().setLockName("_CRU_10234_1_lla_lock"), ParameterException);
+  BOOST_CHECK_EQUAL(detail::cardLockParameters(3, -1).getLockNameRequired(), "_CRU_3_lla_lock");
+  BOOST_CHECK_EQUAL(detail::cardLockParameters(3, 1).getLockNameRequired(), "_CRU_3_1_lla_lock");
+  BOOST_CHECK_NO_THROW(LockParameters::makeParameters().setLockName("_CRU_3_lla_lock_type"));
+}
+
+BOOST_AUTO_TEST_CASE(LongLockNames)
+{
+  // Long names are shortened, keeping their beginning, and still tell locks apart
+  const std::string name = "dummy_" + std::string(100, 'a');
+  auto params = LockParameters::makeParameters().setLockName(name + "1");
+  auto otherParams = LockParameters::makeParameters().setLockName(name + "2");
+  BOOST_CHECK_EQUAL(params.getLockNameRequired().size(), LockParameters::kMaxLockNameLength);
+  BOOST_CHECK_EQUAL(params.getLockNameRequired().substr(0, 6), "dummy_");
+  BOOST_CHECK_NE(params.getLockNameRequired(), otherParams.getLockNameRequired());
+  BOOST_CHECK_EQUAL(LockParameters::makeParameters().setLockName(name + "1").getLockNameRequired(), params.getLockNameRequired());
+
+  auto lock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(otherParams);
+  BOOST_CHECK(lock->tryAcquire() == LockStatus::Acquired);
+  BOOST_CHECK(otherLock->tryAcquire() == LockStatus::Acquired);
+  otherLock->unlock();
+  lock->unlock();
+}
+
 BOOST_AUTO_TEST_CASE(NamedMutexRawLock)
 {
   auto params = LockParameters::makeParameters(LockType::Type::NamedMutex);
@@ -80,6 +116,77 @@ BOOST_AUTO_TEST_CASE(SocketTimedLock)
   BOOST_CHECK(true);
 }
 
+BOOST_AUTO_TEST_CASE(SocketTimedLockWakeup)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::SocketLock);
+  auto socketLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  socketLock->lock();
+
+  std::thread releaser([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    socketLock->unlock();
+  });
+  const auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK(otherLock->timedLock(1000));
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+  releaser.join();
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(SocketLockContention)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::SocketLock);
+  auto socketLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  socketLock->lock();
+  BOOST_CHECK(!socketLock->waitForContention(0));
+
+  std::thread waiter([&]() { BOOST_CHECK(otherLock->timedLock(1000)); });
+  BOOST_CHECK(socketLock->waitForContention(1000));
+  socketLock->unlock();
+  waiter.join();
+
+  // The new holder listens right away, and neither the former holder probing whether it took the
+  // lock nor a waiter that gave up count as contention
+  BOOST_CHECK(!socketLock->timedLock(20));
+  BOOST_CHECK(!otherLock->waitForContention(0));
+
+  std::thread lateWaiter([&]() { BOOST_CHECK(socketLock->timedLock(1000)); });
+  BOOST_CHECK(otherLock->waitForContention(1000));
+  const auto start = std::chrono::steady_clock::now();
+  otherLock->unlock();
+  lateWaiter.join();
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+  socketLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(SocketLockHolderDeath)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::SocketLock);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    auto childLock = InterprocessLockFactory::getInterprocessLock(params);
+    childLock->lock();
+    pause();
+    _exit(0);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50)); // let the child lock
+
+  auto socketLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(!socketLock->tryLock());
+  std::thread killer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    kill(pid, SIGKILL);
+  });
+  BOOST_CHECK(socketLock->timedLock(1000));
+  killer.join();
+  int status;
+  waitpid(pid, &status, 0);
+  socketLock->unlock();
+}
+
 BOOST_AUTO_TEST_CASE(MultiSocketLock)
 {
   std::vector<std::thread> workers;
@@ -269,4 +376,552 @@ BOOST_AUTO_TEST_CASE(UltraNamedMutexLock)
 
   BOOST_CHECK(true);
 }
+
+BOOST_AUTO_TEST_CASE(FileRawLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::FileLock);
+  auto fileLock = InterprocessLockFactory::getInterprocessLock(params);
+  fileLock->lock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50)); // critical section
+  fileLock->unlock();
+  BOOST_CHECK(true);
+}
+
+BOOST_AUTO_TEST_CASE(FileTryLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::FileLock);
+  auto fileLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(fileLock->tryLock());
+  BOOST_CHECK(!otherLock->tryLock());
+  fileLock->unlock();
+  BOOST_CHECK(otherLock->tryLock());
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(FileTimedLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::FileLock);
+  auto fileLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(fileLock->timedLock(50));
+
+  const auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK(!otherLock->timedLock(50));
+  BOOST_CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+
+  std::thread releaser([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    fileLock->unlock();
+  });
+  BOOST_CHECK(otherLock->timedLock(1000));
+  releaser.join();
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(FileTimedLockClaimedSignal)
+{
+  // An application handling the wakeup signal with SA_RESTART, or ignoring it, can't make the
+  // timed wait unbounded
+  auto params = LockParameters::makeParameters(LockType::Type::FileLock);
+  auto fileLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(fileLock->timedLock(50));
+
+  struct sigaction restart, previous;
+  memset(&restart, 0, sizeof(restart));
+  restart.sa_handler = [](int) {};
+  restart.sa_flags = SA_RESTART;
+  sigemptyset(&restart.sa_mask);
+  sigaction(SIGRTMIN + 4, &restart, &previous);
+
+  for (auto handler : { restart.sa_handler, SIG_IGN }) {
+    restart.sa_handler = handler;
+    sigaction(SIGRTMIN + 4, &restart, nullptr);
+    const auto start = std::chrono::steady_clock::now();
+    BOOST_CHECK(!otherLock->timedLock(50));
+    const auto waited = std::chrono::steady_clock::now() - start;
+    BOOST_CHECK(waited >= std::chrono::milliseconds(50) && waited < std::chrono::milliseconds(500));
+  }
+
+  sigaction(SIGRTMIN + 4, &previous, nullptr);
+  fileLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(MultiFileLock)
+{
+  std::vector<std::thread> workers;
+  std::atomic<int> failed(0);
+  for (int i = 0; i < 2; i++) {
+    workers.push_back(std::thread([&]() {
+      auto params = LockParameters::makeParameters(LockType::Type::FileLock);
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+      if (alock->timedLock(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(12)); // critical section
+        alock->unlock();
+      } else {
+        failed++;
+      }
+    }));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  BOOST_CHECK(failed == 1);
+}
+
+BOOST_AUTO_TEST_CASE(UltraFileLock)
+{
+  std::vector<std::thread> workers;
+  std::unordered_map<int, int> umap;
+  for (int i = 0; i < 6; i++) {
+    umap[i] = 0;
+  }
+  for (int i = 0; i < 6; i++) {
+    workers.push_back(std::thread([&](int x) {
+      auto params = LockParameters::makeParameters(LockType::Type::FileLock);
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+
+      const auto start = std::chrono::steady_clock::now();
+      auto timeExceeded = [&]() { return ((std::chrono::steady_clock::now() - start) > std::chrono::seconds(1)); };
+      while (!timeExceeded()) {
+        if (alock->timedLock(100)) {
+          umap[x]++;
+          std::this_thread::sleep_for(std::chrono::milliseconds(10 * x + 2)); // critical section
+          alock->unlock();
+        }
+      }
+    },
+                                  i));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  for (auto& el : umap) {
+    BOOST_CHECK(el.second > 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FutexRawLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::FutexLock);
+  auto futexLock = InterprocessLockFactory::getInterprocessLock(params);
+  futexLock->lock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50)); // critical section
+  futexLock->unlock();
+  BOOST_CHECK(true);
+}
+
+BOOST_AUTO_TEST_CASE(FutexTryLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::FutexLock);
+  auto futexLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(futexLock->tryLock());
+  BOOST_CHECK(!otherLock->tryLock());
+  futexLock->unlock();
+  BOOST_CHECK(otherLock->tryLock());
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(FutexTimedLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::FutexLock);
+  auto futexLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(futexLock->timedLock(50));
+  BOOST_CHECK(!otherLock->timedLock(50));
+
+  std::thread releaser([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    futexLock->unlock();
+  });
+  BOOST_CHECK(otherLock->timedLock(1000));
+  releaser.join();
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(FutexLockAcrossProcesses)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::FutexLock);
+  auto futexLock = InterprocessLockFactory::getInterprocessLock(params);
+  futexLock->lock();
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    auto childLock = InterprocessLockFactory::getInterprocessLock(params);
+    bool busy = !childLock->timedLock(20);
+    bool acquired = childLock->timedLock(1000); // parent releases after 100ms
+    childLock->unlock();
+    _exit(busy && acquired ? 0 : 1);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  futexLock->unlock();
+
+  int status;
+  waitpid(pid, &status, 0);
+  BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(MultiFutexLock)
+{
+  std::vector<std::thread> workers;
+  std::atomic<int> failed(0);
+  for (int i = 0; i < 2; i++) {
+    workers.push_back(std::thread([&]() {
+      auto params = LockParameters::makeParameters(LockType::Type::FutexLock);
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+      if (alock->timedLock(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(12)); // critical section
+        alock->unlock();
+      } else {
+        failed++;
+      }
+    }));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  BOOST_CHECK(failed == 1);
+}
+
+BOOST_AUTO_TEST_CASE(ExclusiveFutexLock)
+{
+  std::vector<std::thread> workers;
+  std::atomic<int> holders(0);
+  std::atomic<bool> overlapped(false);
+  int counter = 0;
+  for (int i = 0; i < 4; i++) {
+    workers.push_back(std::thread([&]() {
+      auto params = LockParameters::makeParameters(LockType::Type::FutexLock);
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+      for (int j = 0; j < 10000; j++) {
+        if (alock->timedLock(1000)) {
+          if (holders++ != 0) {
+            overlapped = true;
+          }
+          counter++; // critical section
+          holders--;
+          alock->unlock();
+        }
+      }
+    }));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  BOOST_CHECK(!overlapped);
+  BOOST_CHECK(counter == 40000);
+}
+
+BOOST_AUTO_TEST_CASE(RobustMutexTryLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::RobustMutex);
+  auto robustMutex = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(robustMutex->tryLock());
+  BOOST_CHECK(!otherLock->tryLock());
+  robustMutex->unlock();
+  BOOST_CHECK(otherLock->tryLock());
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(RobustMutexTimedLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::RobustMutex);
+  auto robustMutex = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(robustMutex->timedLock(50));
+
+  // Held by this thread; another thread has to wait for it
+  bool acquired = true;
+  std::thread waiter([&]() {
+    auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+    acquired = otherLock->timedLock(50);
+  });
+  waiter.join();
+  BOOST_CHECK(!acquired);
+  robustMutex->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(RobustMutexOtherThreadUnlock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::RobustMutex);
+  auto robustMutex = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(robustMutex->tryLock());
+
+  // Another thread can't unlock it, and the lock isn't lost
+  bool threw = false;
+  std::thread other([&]() {
+    try {
+      robustMutex->unlock();
+    } catch (const LlaException&) {
+      threw = true;
+    }
+  });
+  other.join();
+  BOOST_CHECK(threw);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(!otherLock->tryLock());
+  robustMutex->unlock();
+  BOOST_CHECK(otherLock->tryLock());
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(RobustMutexOwnerDead)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::RobustMutex);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    auto childLock = InterprocessLockFactory::getInterprocessLock(params);
+    childLock->lock();
+    _exit(0); // die while holding the lock
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+
+  auto robustMutex = InterprocessLockFactory::getInterprocessLock(params);
+  const auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK(robustMutex->timedLock(1000));
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10));
+  robustMutex->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(MultiRobustMutex)
+{
+  std::vector<std::thread> workers;
+  std::atomic<int> failed(0);
+  for (int i = 0; i < 2; i++) {
+    workers.push_back(std::thread([&]() {
+      auto params = LockParameters::makeParameters(LockType::Type::RobustMutex);
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+      if (alock->timedLock(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(12)); // critical section
+        alock->unlock();
+      } else {
+        failed++;
+      }
+    }));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  BOOST_CHECK(failed == 1);
+}
+
+BOOST_AUTO_TEST_CASE(TicketTryLock)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::TicketLock);
+  auto ticketLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(ticketLock->tryLock());
+  BOOST_CHECK(!otherLock->tryLock());
+  ticketLock->unlock();
+  BOOST_CHECK(otherLock->tryLock());
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(TicketTimedLockAbandon)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::TicketLock);
+  auto ticketLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(ticketLock->timedLock(50));
+  BOOST_CHECK(!otherLock->timedLock(20)); // abandons its ticket
+  ticketLock->unlock();                   // skips the abandoned ticket
+  BOOST_CHECK(otherLock->tryLock());
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(TicketTimedLockWrapAround)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::TicketLock);
+  auto ticketLock = InterprocessLockFactory::getInterprocessLock(params);
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(ticketLock->tryLock());
+
+  // More abandoned tickets than slots never pass for a grant
+  for (int i = 0; i < 2 * TICKET_LOCK_SLOTS; i++) {
+    BOOST_REQUIRE(!otherLock->timedLock(1));
+  }
+  ticketLock->unlock();
+  BOOST_CHECK(otherLock->timedLock(100));
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(TicketLockFifo)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::TicketLock);
+  auto ticketLock = InterprocessLockFactory::getInterprocessLock(params);
+  ticketLock->lock();
+
+  std::vector<std::thread> workers;
+  std::vector<int> order;
+  std::mutex orderMutex;
+  for (int i = 0; i < 4; i++) {
+    workers.push_back(std::thread([&](int x) {
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+      if (alock->timedLock(2000)) {
+        {
+          std::lock_guard<std::mutex> guard(orderMutex);
+          order.push_back(x);
+        }
+        alock->unlock();
+      }
+    },
+                                  i));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // let it queue up
+  }
+
+  ticketLock->unlock();
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  BOOST_CHECK(order == std::vector<int>({ 0, 1, 2, 3 }));
+}
+
+BOOST_AUTO_TEST_CASE(TicketLockDeadWaiter)
+{
+  auto params = LockParameters::makeParameters(LockType::Type::TicketLock);
+  auto ticketLock = InterprocessLockFactory::getInterprocessLock(params);
+  ticketLock->lock();
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    auto childLock = InterprocessLockFactory::getInterprocessLock(params);
+    childLock->timedLock(10000);
+    _exit(0);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50)); // let the child queue up
+  kill(pid, SIGKILL);
+  int status;
+  waitpid(pid, &status, 0);
+
+  ticketLock->unlock(); // skips the dead waiter
+  auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+  BOOST_CHECK(otherLock->timedLock(100));
+  otherLock->unlock();
+}
+
+BOOST_AUTO_TEST_CASE(MultiTicketLock)
+{
+  std::vector<std::thread> workers;
+  std::atomic<int> failed(0);
+  for (int i = 0; i < 2; i++) {
+    workers.push_back(std::thread([&]() {
+      auto params = LockParameters::makeParameters(LockType::Type::TicketLock);
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+      if (alock->timedLock(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(12)); // critical section
+        alock->unlock();
+      } else {
+        failed++;
+      }
+    }));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  BOOST_CHECK(failed == 1);
+}
+
+BOOST_AUTO_TEST_CASE(UltraTicketLock)
+{
+  std::vector<std::thread> workers;
+  std::unordered_map<int, int> umap;
+  for (int i = 0; i < 6; i++) {
+    umap[i] = 0;
+  }
+  for (int i = 0; i < 6; i++) {
+    workers.push_back(std::thread([&](int x) {
+      auto params = LockParameters::makeParameters(LockType::Type::TicketLock);
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+
+      const auto start = std::chrono::steady_clock::now();
+      auto timeExceeded = [&]() { return ((std::chrono::steady_clock::now() - start) > std::chrono::seconds(1)); };
+      while (!timeExceeded()) {
+        if (alock->timedLock(300)) {
+          umap[x]++;
+          std::this_thread::sleep_for(std::chrono::milliseconds(10 * x + 2)); // critical section
+          alock->unlock();
+        }
+      }
+    },
+                                  i));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  // Every thread waits at most for one critical section of each other thread
+  for (auto& el : umap) {
+    BOOST_CHECK(el.second > 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WaitStrategies)
+{
+  auto lockTypes = { LockType::Type::SocketLock, LockType::Type::NamedMutex, LockType::Type::FileLock,
+                     LockType::Type::FutexLock, LockType::Type::RobustMutex, LockType::Type::TicketLock };
+  auto waitStrategies = { WaitStrategy::Spin, WaitStrategy::SpinYield, WaitStrategy::Backoff, WaitStrategy::Park };
+
+  for (auto lockType : lockTypes) {
+    for (auto waitStrategy : waitStrategies) {
+      auto params = LockParameters::makeParameters(lockType).setWaitStrategy(waitStrategy);
+      std::atomic<bool> locked(false);
+      std::thread holder([&]() {
+        auto alock = InterprocessLockFactory::getInterprocessLock(params);
+        alock->lock();
+        locked = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(30)); // critical section
+        alock->unlock();
+      });
+      while (!locked) {
+        std::this_thread::yield();
+      }
+
+      auto alock = InterprocessLockFactory::getInterprocessLock(params);
+      BOOST_CHECK_MESSAGE(!alock->timedLock(5), "lock type " << lockType << ", wait strategy " << waitStrategy);
+      BOOST_CHECK_MESSAGE(alock->timedLock(1000), "lock type " << lockType << ", wait strategy " << waitStrategy);
+      alock->unlock();
+      holder.join();
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LockStatuses)
+{
+  auto lockTypes = { LockType::Type::SocketLock, LockType::Type::NamedMutex, LockType::Type::FileLock,
+                     LockType::Type::FutexLock, LockType::Type::RobustMutex, LockType::Type::TicketLock };
+
+  for (auto lockType : lockTypes) {
+    auto params = LockParameters::makeParameters(lockType);
+    auto alock = InterprocessLockFactory::getInterprocessLock(params);
+    auto otherLock = InterprocessLockFactory::getInterprocessLock(params);
+    BOOST_CHECK_MESSAGE(alock->tryAcquire() == LockStatus::Acquired, "lock type " << lockType);
+    BOOST_CHECK_MESSAGE(alock->tryAcquire() == LockStatus::AlreadyLocked, "lock type " << lockType);
+    BOOST_CHECK_MESSAGE(otherLock->tryAcquire() == LockStatus::Busy, "lock type " << lockType);
+    BOOST_CHECK_MESSAGE(otherLock->timedAcquire(5) == LockStatus::TimedOut, "lock type " << lockType);
+    BOOST_CHECK_THROW(otherLock->lock(), LlaException);
+    alock->unlock();
+    BOOST_CHECK_MESSAGE(otherLock->timedAcquire(5) == LockStatus::Acquired, "lock type " << lockType);
+    otherLock->unlock();
+  }
+}
 BOOST_AUTO_TEST_SUITE_END()
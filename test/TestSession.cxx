@@ -20,14 +20,61 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <string>
 #include <thread>
+#include <vector>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <Lla/BasicSession.h>
 #include <Lla/Exception.h>
 #include <Lla/Session.h>
+#include <Lla/SessionGroup.h>
+#include <Lla/Locks/FutexLock.h>
+#include <Lla/Locks/SocketLock.h>
+#include <LockTypeSelector.h>
 
 using namespace o2::lla;
 
+namespace
+{
+/// Sets the lock type of the Sessions through the environment until the end of the scope; the
+/// suite itself may run with O2_LLA_LOCK_TYPE set
+class LockTypeOverride
+{
+ public:
+  /// \param lockType The lock type, or nullptr for none
+  LockTypeOverride(const char* lockType)
+  {
+    const char* previous = getenv("O2_LLA_LOCK_TYPE");
+    mPrevious = previous ? previous : "";
+    set(lockType);
+  }
+
+  ~LockTypeOverride()
+  {
+    set(mPrevious.empty() ? nullptr : mPrevious.c_str());
+  }
+
+  void set(const char* lockType)
+  {
+    if (lockType) {
+      setenv("O2_LLA_LOCK_TYPE", lockType, 1);
+    } else {
+      unsetenv("O2_LLA_LOCK_TYPE");
+    }
+  }
+
+ private:
+  std::string mPrevious;
+};
+} // anonymous namespace
+
 BOOST_AUTO_TEST_SUITE(LowLevelArbitrationSession)
 
 BOOST_AUTO_TEST_CASE(SessionEasyCreate)
@@ -147,4 +194,905 @@ BOOST_AUTO_TEST_CASE(SessionsCreateLocked)
   }
 }
 
+BOOST_AUTO_TEST_CASE(TimedSessionsWaitStrategies)
+{
+  for (auto waitStrategy : { WaitStrategy::Spin, WaitStrategy::SpinYield, WaitStrategy::Backoff, WaitStrategy::Park }) {
+    SessionParameters params = SessionParameters::makeParameters("KSA", "#3")
+                                 .setWaitStrategy(waitStrategy);
+    Session sessionA = Session(params);
+    Session sessionB = Session(params);
+    BOOST_CHECK(sessionA.timedStart(10));
+    BOOST_CHECK(!sessionB.timedStart(10));
+
+    std::thread stopper([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      sessionA.stop();
+    });
+    BOOST_CHECK(sessionB.timedStart(1000));
+    stopper.join();
+    sessionB.stop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BiasedSession)
+{
+  // Another process finds the card locked, and revokes the bias by waiting for it
+  // Forked before locking, so that it doesn't inherit the lock
+  pid_t pid = fork();
+  if (pid == 0) {
+    SessionParameters params = SessionParameters::makeParameters("KSA", "#3");
+    Session session = Session(params);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // let the parent lock and stop
+    if (session.start()) {
+      _exit(1);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (!session.timedStart(1000) || std::chrono::steady_clock::now() - start > std::chrono::milliseconds(500)) {
+      _exit(2);
+    }
+    session.stop();
+    _exit(0);
+  }
+
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#3")
+                               .setBiasGracePeriod(2000);
+  Session sessionA = Session(params);
+  BOOST_CHECK(sessionA.start());
+  sessionA.stop();
+  BOOST_CHECK(!sessionA.isStarted());
+  BOOST_CHECK(sessionA.start()); // Still biased
+  sessionA.stop();
+
+  int status;
+  waitpid(pid, &status, 0);
+  BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  BOOST_CHECK(sessionA.timedStart(100));
+  sessionA.stop();
+}
+
+BOOST_AUTO_TEST_CASE(SessionsHandoff)
+{
+  std::vector<std::thread> workers;
+  std::atomic<int> inside(0);
+  std::atomic<int> overlaps(0);
+  std::atomic<int> count(0);
+  for (int i = 0; i < 4; i++) {
+    workers.push_back(std::thread([&]() {
+      SessionParameters params = SessionParameters::makeParameters("KSA", "#3");
+      Session session = Session(params);
+      for (int j = 0; j < 100; j++) {
+        if (session.timedStart(2000)) {
+          if (inside++ != 0) {
+            overlaps++;
+          }
+          count++;
+          inside--;
+          session.stop();
+        }
+      }
+    }));
+  }
+
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) {
+    t.join();
+  });
+
+  BOOST_CHECK(overlaps == 0);
+  BOOST_CHECK(count == 400);
+}
+
+BOOST_AUTO_TEST_CASE(NestedSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#3");
+  Session outer = Session(params);
+  params.setReentrant(true);
+  Session inner = Session(params);
+  Session other = Session(params);
+  auto otherStarts = [&]() {
+    bool started = false;
+    std::thread([&]() { started = other.timedStart(10); }).join();
+    return started;
+  };
+
+  BOOST_CHECK(outer.start());
+  BOOST_CHECK(inner.timedStart(10));
+  BOOST_CHECK(!otherStarts());
+
+  // The card is released by whichever nested Session stops last
+  outer.stop();
+  BOOST_CHECK(!otherStarts());
+  inner.stop();
+  BOOST_CHECK(otherStarts());
+  other.stop();
+}
+
+BOOST_AUTO_TEST_CASE(BasicSessions)
+{
+  LockTypeOverride environment(nullptr); // Sessions use the SocketLock by default
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#3");
+  {
+    BasicSession<FutexLock> sessionA(params);
+    BasicSession<FutexLock> sessionB(params);
+    BOOST_CHECK(sessionA.start());
+    BOOST_CHECK(sessionA.isStarted());
+    BOOST_CHECK(!sessionB.start());
+    BOOST_CHECK(!sessionB.timedStart(10));
+    sessionA.stop();
+    BOOST_CHECK(sessionB.timedStart(10));
+    sessionB.stop();
+
+    // The card is used with the FutexLock while they're around
+    BOOST_CHECK_THROW(Session session = Session(params), ParameterException);
+  }
+
+  // Sessions with the same lock implementation exclude each other
+  Session session = Session(params);
+  BasicSession<SocketLock> sessionC(params);
+  BOOST_CHECK(session.start());
+  BOOST_CHECK(!sessionC.start());
+  session.stop();
+  BOOST_CHECK(sessionC.start());
+  BOOST_CHECK(!session.start());
+  sessionC.stop();
+
+  // BasicSessions don't lease, queue with a priority, nor have quotas or schedules
+  BOOST_CHECK_THROW(BasicSession<SocketLock> leased(SessionParameters(params).setLeaseTime(100)), ParameterException);
+  BOOST_CHECK_THROW(BasicSession<SocketLock> queued(SessionParameters(params).setPriority(1)), ParameterException);
+  BOOST_CHECK_THROW(BasicSession<SocketLock> quota(SessionParameters(params).setHoldQuota(50)), ParameterException);
+  BOOST_CHECK_THROW(BasicSession<SocketLock> scheduled(SessionParameters(params).setSchedule(Schedule().addSlot(ClientClass::Control, 10))), ParameterException);
+}
+
+BOOST_AUTO_TEST_CASE(BasicSessionsSharingCards)
+{
+  LockTypeOverride environment(nullptr);
+  SessionParameters params = SessionParameters::makeParameters("KSA", "10239:0");
+  BasicSession<SocketLock> basic(params);
+
+  // Sessions on links and on endpoints exclude it, as they do Sessions on the whole card
+  Session link = Session(SessionParameters(params).setLinkId(0));
+  BOOST_CHECK(link.start());
+  BOOST_CHECK(!basic.start());
+  BOOST_CHECK(!basic.timedStart(10));
+  link.stop();
+  BOOST_CHECK(basic.start());
+  BOOST_CHECK(!link.start());
+  basic.stop();
+
+  Session endpoint = Session(SessionParameters(params).setLockGranularity(LockGranularity::Endpoint));
+  BOOST_CHECK(endpoint.start());
+  BOOST_CHECK(!basic.start());
+  endpoint.stop();
+  BOOST_CHECK(basic.start());
+  BOOST_CHECK(!endpoint.start());
+  basic.stop();
+
+  // It waits for leases, and for recipients of handoffs
+  Session leased = Session(SessionParameters(params).setLeaseTime(1000));
+  BOOST_CHECK(leased.start());
+  BOOST_CHECK(!basic.start());
+  leased.stop();
+  BOOST_CHECK(basic.start());
+  basic.stop();
+
+  Session fred = Session(SessionParameters(params).setSessionName("FRED"));
+  BasicSession<SocketLock> debug(SessionParameters(params).setSessionName("DEBUG"));
+  BOOST_CHECK(fred.start());
+  fred.handOff("DEBUG", 1000);
+  BOOST_CHECK(!basic.start());
+  BOOST_CHECK(debug.start());
+  debug.stop();
+  BOOST_CHECK(basic.start());
+  basic.stop();
+
+  // And it's charged to, and held back by, the HoldQuota of ClientClass::Control
+  boost::interprocess::shared_memory_object::remove("_CRU_10239_lla_quota");
+  Session quota = Session(SessionParameters(params).setHoldQuota(20));
+  BOOST_CHECK(basic.start());
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  basic.stop();
+  BOOST_CHECK(!quota.start());
+  BOOST_CHECK(!basic.start());
+  BOOST_CHECK(basic.timedStart(2000));
+  basic.stop();
+}
+
+BOOST_AUTO_TEST_CASE(SessionLockTypes)
+{
+  LockTypeOverride environment(nullptr);
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#3")
+                               .setLockType(LockType::FutexLock);
+  {
+    Session session = Session(params);
+    BasicSession<FutexLock> futexSession(params);
+    BOOST_CHECK(session.start());
+    BOOST_CHECK(!futexSession.start());
+    session.stop();
+
+    // Locks of different types don't exclude each other, so a card uses one at a time
+    BOOST_CHECK_THROW(Session socketSession = Session(SessionParameters(params).setLockType(LockType::SocketLock)), ParameterException);
+  }
+
+  // The environment overrides the parameters
+  environment.set("socket-lock");
+  {
+    Session overridden = Session(params);
+    BasicSession<SocketLock> socketSession(params);
+    BOOST_CHECK(overridden.start());
+    BOOST_CHECK(!socketSession.start());
+    overridden.stop();
+  }
+
+  environment.set("no-lock");
+  BOOST_CHECK_THROW(Session failing = Session(params), ParameterException);
+  environment.set(nullptr);
+
+  // Calibrated Sessions agree on the lock type, which is robust, and releasable by any thread
+  auto calibrated = LockTypeSelector::select(LockType::Auto);
+  BOOST_CHECK(calibrated == LockType::SocketLock || calibrated == LockType::FileLock);
+  params.setLockType(LockType::Auto);
+  Session sessionA = Session(params);
+  Session sessionB = Session(params);
+  BOOST_CHECK(sessionA.start());
+  BOOST_CHECK(!sessionB.start());
+}
+
+BOOST_AUTO_TEST_CASE(ProcessesAgreeOnLockTypes)
+{
+  LockTypeOverride environment(nullptr);
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#3")
+                               .setLockType(LockType::FutexLock);
+  pid_t pid = fork();
+  if (pid == 0) {
+    Session session = Session(params);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let the parent try another type
+    _exit(0);
+  }
+
+  // The type recorded by the other process holds until it's gone
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  BOOST_CHECK_THROW(Session socketSession = Session(SessionParameters(params).setLockType(LockType::SocketLock)), ParameterException);
+  {
+    Session futexSession = Session(params);
+    int status;
+    waitpid(pid, &status, 0);
+    BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    BOOST_CHECK_THROW(Session socketSession = Session(SessionParameters(params).setLockType(LockType::SocketLock)), ParameterException);
+  }
+
+  Session socketSession = Session(SessionParameters(params).setLockType(LockType::SocketLock));
+  BOOST_CHECK(socketSession.start());
+  socketSession.stop();
+}
+
+BOOST_AUTO_TEST_CASE(MutexSessionsStoppedByOtherThreads)
+{
+  LockTypeOverride environment(nullptr);
+  for (auto lockType : { LockType::RobustMutex, LockType::NamedMutex }) {
+    SessionParameters params = SessionParameters::makeParameters("KSA", "10238:0")
+                                 .setLockType(lockType);
+    Session session = Session(params);
+    std::atomic<bool> started{ false };
+    std::atomic<bool> stopping{ false };
+    std::thread holder([&]() {
+      started = session.start();
+      while (!stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      session.stop();
+    });
+    while (!started) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // The mutex belongs to the holder's thread; the Session stays started, and stoppable by it
+    BOOST_CHECK_THROW(session.stop(), LlaException);
+    BOOST_CHECK(session.isStarted());
+    BOOST_CHECK_THROW(session.handOff("KSA", 100), LlaException);
+    BOOST_CHECK(session.isStarted());
+    stopping = true;
+    holder.join();
+    BOOST_CHECK(!session.isStarted());
+    BOOST_CHECK(session.start());
+    session.stop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(EndpointSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "10234:0")
+                               .setLockGranularity(LockGranularity::Endpoint);
+  Session endpoint0 = Session(params);
+  Session endpoint0Again = Session(params);
+  params.setCardId(std::string("10234:1"));
+  Session endpoint1 = Session(params);
+  params.setLockGranularity(LockGranularity::Card);
+  Session card = Session(params);
+
+  // The endpoints of a card are independent
+  BOOST_CHECK(endpoint0.start());
+  BOOST_CHECK(endpoint1.start());
+  BOOST_CHECK(!endpoint0Again.start());
+  BOOST_CHECK(!card.timedStart(10));
+
+  // A Card Session excludes both
+  endpoint0.stop();
+  endpoint1.stop();
+  BOOST_CHECK(card.start());
+  BOOST_CHECK(!endpoint0.start());
+  BOOST_CHECK(!endpoint1.timedStart(10));
+  card.stop();
+  BOOST_CHECK(endpoint1.start());
+
+  BOOST_CHECK_THROW(BasicSession<SocketLock> basicSession(SessionParameters(params).setLockGranularity(LockGranularity::Endpoint)), ParameterException);
+}
+
+BOOST_AUTO_TEST_CASE(LinkSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "10235:0");
+  Session card = Session(params);
+  params.setLinkId(1);
+  Session link1 = Session(params);
+  Session link1Again = Session(params);
+  params.setLinkId(2);
+  Session link2 = Session(params);
+  params.setRegisterGroup(0);
+  Session group0 = Session(params);
+  params.setRegisterGroup(1);
+  Session group1 = Session(params);
+
+  // Different links, and different register groups of a link, are independent
+  BOOST_CHECK(link1.start());
+  BOOST_CHECK(group0.start());
+  BOOST_CHECK(group1.start());
+  BOOST_CHECK(!link1Again.start());
+  BOOST_CHECK(!link2.timedStart(10));
+
+  // The card excludes them all
+  BOOST_CHECK(!card.timedStart(10));
+  link1.stop();
+  group0.stop();
+  group1.stop();
+  BOOST_CHECK(card.timedStart(10));
+  BOOST_CHECK(!link2.start());
+  card.stop();
+  BOOST_CHECK(link2.start());
+  link2.stop();
+
+  // The grants of a process that died are reclaimed
+  pid_t pid = fork();
+  if (pid == 0) {
+    _exit(link1.start() ? 0 : 1);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  BOOST_CHECK(link1Again.start());
+
+  BOOST_CHECK_THROW(Session session = Session(params.setLinkId(24)), ParameterException);
+  SessionParameters noLink = SessionParameters::makeParameters("KSA", "10235:0").setRegisterGroup(0);
+  BOOST_CHECK_THROW(Session session = Session(noLink), ParameterException);
+}
+
+BOOST_AUTO_TEST_CASE(SharedSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "10236:0");
+  Session writer = Session(params);
+  params.setAccessMode(AccessMode::Shared);
+  Session readerA = Session(params);
+  Session readerB = Session(params);
+
+  BOOST_CHECK(readerA.start());
+  BOOST_CHECK(readerB.start());
+  BOOST_CHECK(!writer.timedStart(10));
+  readerA.stop();
+  readerB.stop();
+  BOOST_CHECK(writer.start());
+  BOOST_CHECK(!readerA.timedStart(10));
+  writer.stop();
+
+  // A waiting writer keeps new readers out
+  BOOST_CHECK(readerA.start());
+  std::atomic<bool> written{ false };
+  std::thread writerThread([&]() {
+    written = writer.timedStart(2000);
+    writer.stop();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  BOOST_CHECK(!readerB.start());
+  readerA.stop();
+  writerThread.join();
+  BOOST_CHECK(written);
+  BOOST_CHECK(readerB.start());
+}
+
+BOOST_AUTO_TEST_CASE(SessionGroups)
+{
+  std::vector<SessionParameters> params = {
+    SessionParameters::makeParameters("KSA", "#5"),
+    SessionParameters::makeParameters("KSA", "#4"),
+    SessionParameters::makeParameters("KSA", "#6")
+  };
+  SessionGroup group(params);
+  std::reverse(params.begin(), params.end());
+  SessionGroup reversed(params);
+  SessionParameters single = SessionParameters::makeParameters("KSA", "#6");
+  Session session = Session(single);
+
+  BOOST_CHECK(group.start());
+  BOOST_CHECK(!reversed.timedStart(10));
+  BOOST_CHECK(!session.start());
+  group.stop();
+
+  // Partial failure releases the cards already taken
+  BOOST_CHECK(session.start());
+  BOOST_CHECK(!group.timedStart(10));
+  BOOST_CHECK(!group.isStarted());
+  BOOST_CHECK(!reversed.timedStart(10));
+  session.stop();
+  BOOST_CHECK(reversed.start());
+  reversed.stop();
+
+  // Groups taking the cards in opposite orders don't deadlock
+  std::atomic<int> started{ 0 };
+  auto run = [&](SessionGroup& sessionGroup) {
+    for (int i = 0; i < 100; ++i) {
+      if (sessionGroup.timedStart(2000)) {
+        started++;
+        sessionGroup.stop();
+      }
+    }
+  };
+  std::thread thread([&]() { run(reversed); });
+  run(group);
+  thread.join();
+  BOOST_CHECK_EQUAL(started, 200);
+
+  params.push_back(SessionParameters::makeParameters("KSA", "#4"));
+  BOOST_CHECK_THROW(SessionGroup duplicate(params), ParameterException);
+}
+
+BOOST_AUTO_TEST_CASE(OverlappingSessionGroups)
+{
+  // A whole card, or endpoint, overlaps its links, and a link its register groups
+  auto link = [](int linkId) { return SessionParameters::makeParameters("KSA", "#4").setLinkId(linkId); };
+  std::vector<std::vector<SessionParameters>> overlapping = {
+    { SessionParameters::makeParameters("KSA", "#4"), link(0) },
+    { SessionParameters::makeParameters("KSA", "#4").setLockGranularity(LockGranularity::Endpoint), link(1) },
+    { link(2), link(2).setRegisterGroup(3) }
+  };
+  for (const auto& params : overlapping) {
+    BOOST_CHECK_THROW(SessionGroup group(params), ParameterException);
+  }
+
+  // Disjoint or shared parts don't
+  SessionGroup links({ link(0), link(1).setRegisterGroup(3), link(1).setRegisterGroup(4) });
+  BOOST_CHECK(links.start());
+  links.stop();
+  SessionGroup shared({ SessionParameters::makeParameters("KSA", "#4").setAccessMode(AccessMode::Shared),
+                        link(0).setAccessMode(AccessMode::Shared) });
+  BOOST_CHECK(shared.start());
+  shared.stop();
+}
+
+BOOST_AUTO_TEST_CASE(AnySessions)
+{
+  std::vector<Session> holders;
+  std::vector<Session> sessions;
+  for (auto cardId : { "#4", "#5", "#6" }) {
+    SessionParameters params = SessionParameters::makeParameters("KSA", cardId);
+    holders.emplace_back(params);
+    sessions.emplace_back(params);
+  }
+  for (auto& holder : holders) {
+    BOOST_CHECK(holder.start());
+  }
+  BOOST_CHECK(Session::timedStartAny(sessions, 10) == nullptr);
+
+  // Woken up by the release of whichever card frees up
+  std::thread releaser([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    holders[1].stop();
+  });
+  auto start = std::chrono::steady_clock::now();
+  Session* session = Session::timedStartAny(sessions, 2000);
+  auto waited = std::chrono::steady_clock::now() - start;
+  releaser.join();
+  BOOST_CHECK(session == &sessions[1]);
+  BOOST_CHECK(sessions[1].isStarted());
+  BOOST_CHECK(!sessions[0].isStarted() && !sessions[2].isStarted());
+  BOOST_CHECK(waited < std::chrono::milliseconds(90));
+
+  // Queued meanwhile, it comes before waiters in timedStart() that came later
+  sessions[1].stop();
+  BOOST_CHECK(holders[1].start());
+  std::atomic<int> order{ 0 };
+  std::atomic<int> anyTurn{ 0 };
+  std::atomic<int> otherTurn{ 0 };
+  std::thread anyThread([&]() {
+    if (Session* any = Session::timedStartAny(sessions, 2000)) {
+      anyTurn = ++order;
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      any->stop();
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  SessionParameters otherParams = SessionParameters::makeParameters("KSA", "#5");
+  Session other = Session(otherParams);
+  std::thread otherThread([&]() {
+    if (other.timedStart(2000)) {
+      otherTurn = ++order;
+      other.stop();
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  holders[1].stop();
+  anyThread.join();
+  otherThread.join();
+  BOOST_CHECK_EQUAL(anyTurn, 1);
+  BOOST_CHECK_EQUAL(otherTurn, 2);
+}
+
+BOOST_AUTO_TEST_CASE(DeadlockedSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#4");
+  Session heldA = Session(params);
+  Session waitedA = Session(params);
+  params.setCardId(std::string("#5"));
+  Session heldB = Session(params);
+  Session waitedB = Session(params);
+
+  BOOST_CHECK(heldA.start());
+  std::atomic<bool> holdingB{ false };
+  std::atomic<bool> startedA{ false };
+  std::thread other([&]() {
+    holdingB = heldB.start();
+    startedA = waitedA.timedStart(2000);
+    waitedA.stop();
+    heldB.stop();
+  });
+  while (!holdingB) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // The other thread holds B and waits for A; waiting for B closes the cycle
+  auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK_THROW(waitedB.timedStart(2000), DeadlockException);
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+  BOOST_CHECK(!waitedB.isStarted());
+  heldA.stop();
+  other.join();
+  BOOST_CHECK(startedA);
+
+  // Waiting for a card held by the same thread just times out
+  BOOST_CHECK(heldA.start());
+  BOOST_CHECK(!waitedA.timedStart(10));
+}
+
+BOOST_AUTO_TEST_CASE(HandedOffSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("FRED", "#4");
+  Session fred = Session(params);
+  Session debug = Session(params.setSessionName("DEBUG"));
+  Session other = Session(params.setSessionName("OTHER"));
+
+  BOOST_CHECK_THROW(fred.handOff("DEBUG", 1000), LlaException);
+  BOOST_CHECK(fred.start());
+  fred.handOff("DEBUG", 1000);
+  BOOST_CHECK(!fred.isStarted());
+  BOOST_CHECK(!other.start());
+  BOOST_CHECK(debug.start());
+  debug.stop();
+  BOOST_CHECK(other.start());
+  other.stop();
+
+  // Waiters don't barge in ahead of the recipient
+  std::atomic<bool> otherStarted{ false };
+  BOOST_CHECK(fred.start());
+  std::thread waiter([&]() {
+    otherStarted = other.timedStart(2000);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  fred.handOff("DEBUG", 1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  BOOST_CHECK(!otherStarted);
+  BOOST_CHECK(debug.timedStart(100));
+  debug.stop();
+  waiter.join();
+  BOOST_CHECK(otherStarted);
+  other.stop();
+
+  // The card is kept after the holder's process exits, until the reservation expires
+  pid_t pid = fork();
+  if (pid == 0) {
+    bool handedOff = fred.start();
+    if (handedOff) {
+      fred.handOff("DEBUG", 100);
+    }
+    _exit(handedOff ? 0 : 1);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  BOOST_CHECK(!other.start());
+  BOOST_CHECK(other.timedStart(1000));
+}
+
+BOOST_AUTO_TEST_CASE(LeasedSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#6");
+  Session other = Session(params);
+  Session leased = Session(params.setLeaseTime(100));
+  SessionParameters linkParams = SessionParameters(params).setLinkId(0);
+  BOOST_CHECK_THROW(Session session = Session(linkParams), ParameterException);
+
+  BOOST_CHECK(!leased.renew());
+  BOOST_CHECK(leased.start());
+  auto generation = leased.getLeaseGeneration();
+  BOOST_CHECK(!other.start());
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  BOOST_CHECK(leased.renew());
+  std::this_thread::sleep_for(std::chrono::milliseconds(70));
+  BOOST_CHECK(!other.timedStart(10));
+  leased.stop();
+  BOOST_CHECK(other.start());
+  other.stop();
+
+  // A holder that doesn't renew in time loses the card
+  BOOST_CHECK(leased.start());
+  BOOST_CHECK(leased.getLeaseGeneration() > generation);
+  generation = leased.getLeaseGeneration();
+  auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK(other.timedStart(1000));
+  BOOST_CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(90));
+  BOOST_CHECK(!leased.renew());
+  BOOST_CHECK(!leased.isStarted());
+  BOOST_CHECK(!leased.timedStart(10));
+  other.stop();
+  BOOST_CHECK(leased.start());
+  BOOST_CHECK(leased.getLeaseGeneration() > generation);
+}
+
+BOOST_AUTO_TEST_CASE(PrioritizedSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#7");
+  Session holder = Session(params);
+  Session debug = Session(params);
+  Session fred = Session(params.setPriority(10));
+
+  // The higher priority waiter comes first, even when it queues last
+  BOOST_CHECK(holder.start());
+  std::atomic<int> order{ 0 };
+  std::atomic<int> debugTurn{ 0 };
+  std::atomic<int> fredTurn{ 0 };
+  std::thread debugThread([&]() {
+    if (debug.timedStart(2000)) {
+      debugTurn = ++order;
+      debug.stop();
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::thread fredThread([&]() {
+    if (fred.timedStart(2000)) {
+      fredTurn = ++order;
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      fred.stop();
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  holder.stop();
+  fredThread.join();
+  debugThread.join();
+  BOOST_CHECK_EQUAL(fredTurn, 1);
+  BOOST_CHECK_EQUAL(debugTurn, 2);
+}
+
+BOOST_AUTO_TEST_CASE(QueuedLinkSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "10237:0").setLinkId(0);
+  Session link0 = Session(params);
+  SessionParameters waiterParams = SessionParameters(params).setPriority(10);
+  Session link0Waiter = Session(waiterParams);
+  params.setLinkId(1);
+  Session link1 = Session(params);
+  Session link1Again = Session(params);
+
+  // A waiter queued for link 0 only holds back, and asks to yield, Sessions on link 0
+  BOOST_CHECK(link0.start());
+  BOOST_CHECK(link1.start());
+  std::atomic<bool> waited{ false };
+  std::thread waiterThread([&]() {
+    waited = link0Waiter.timedStart(2000);
+    link0Waiter.stop();
+  });
+  for (int i = 0; i < 1000 && !link0.isYieldRequested(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_CHECK(link0.isYieldRequested());
+  BOOST_CHECK(!link1.isYieldRequested());
+
+  // Meanwhile, link 1 keeps changing hands
+  link1.stop();
+  for (int i = 0; i < 10; ++i) {
+    BOOST_CHECK(link1Again.start());
+    link1Again.stop();
+    BOOST_CHECK(link1.timedStart(100));
+    link1.stop();
+  }
+  BOOST_CHECK(!waited);
+  link0.stop();
+  waiterThread.join();
+  BOOST_CHECK(waited);
+}
+
+BOOST_AUTO_TEST_CASE(PreemptedSessions)
+{
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#7");
+  Session debug = Session(params);
+  Session fred = Session(params.setPriority(10).setPreemptTimeOut(50));
+  auto yieldRequested = [](Session& session) {
+    for (int i = 0; i < 1000 && !session.isYieldRequested(); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return session.isYieldRequested();
+  };
+
+  // A well-behaved holder yields when asked
+  BOOST_CHECK(debug.start());
+  BOOST_CHECK(!debug.isYieldRequested());
+  std::atomic<bool> fredStarted{ false };
+  std::thread fredThread([&]() {
+    fredStarted = fred.timedStart(2000);
+    fred.stop();
+  });
+  BOOST_CHECK(yieldRequested(debug));
+  debug.stop();
+  fredThread.join();
+  BOOST_CHECK(fredStarted);
+  BOOST_CHECK(!debug.isYieldRequested());
+
+  // Otherwise its lease is revoked once the PreemptTimeOut expires
+  SessionParameters leaseParams = SessionParameters::makeParameters("KSA", "#7").setLeaseTime(5000);
+  Session leased = Session(leaseParams);
+  BOOST_CHECK(leased.start());
+  auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK(fred.timedStart(2000));
+  auto waited = std::chrono::steady_clock::now() - start;
+  BOOST_CHECK(waited >= std::chrono::milliseconds(50) && waited < std::chrono::milliseconds(1000));
+  BOOST_CHECK(!leased.renew());
+  fred.stop();
+}
+
+BOOST_AUTO_TEST_CASE(QuotaSessions)
+{
+  // The budgets outlive the processes; start from a full bucket, whatever previous runs charged
+  boost::interprocess::shared_memory_object::remove("_CRU_6_lla_quota");
+  SessionParameters toolParams = SessionParameters::makeParameters("KSA", "#6");
+  Session tool = Session(toolParams.setClientClass(ClientClass::Debug));
+  SessionParameters fredParams = SessionParameters::makeParameters("KSA", "#6");
+  Session fred = Session(fredParams);
+  {
+    SessionParameters params = SessionParameters::makeParameters("KSA", "#6");
+    Session debug = Session(params.setClientClass(ClientClass::Debug).setHoldQuota(20));
+    BOOST_CHECK_THROW(Session(params.setHoldQuota(0)), ParameterException);
+    BOOST_CHECK_THROW(Session(params.setHoldQuota(50)), ParameterException);
+
+    // Holding 300 ms at 20% of a second puts the debug class 500 ms over budget
+    BOOST_CHECK(debug.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    debug.stop();
+    BOOST_CHECK(!debug.start());
+    BOOST_CHECK(!debug.timedStart(100));
+
+    // The quota applies to the whole class, not only to the Sessions that set it
+    BOOST_CHECK(!tool.start());
+
+    // Other classes aren't affected
+    BOOST_CHECK(fred.start());
+    fred.stop();
+
+    auto start = std::chrono::steady_clock::now();
+    BOOST_CHECK(tool.timedStart(2000));
+    auto waited = std::chrono::steady_clock::now() - start;
+    BOOST_CHECK(waited >= std::chrono::milliseconds(300) && waited < std::chrono::milliseconds(1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    tool.stop();
+    BOOST_CHECK(!debug.start());
+  }
+
+  // Without its owner, the quota is cleared
+  BOOST_CHECK(tool.start());
+  tool.stop();
+}
+
+BOOST_AUTO_TEST_CASE(ScheduledSessions)
+{
+  BOOST_CHECK_THROW(Schedule().addSlot(ClientClass::Debug, 0), ParameterException);
+  auto schedule = Schedule().addSlot(ClientClass::Control, 80).addSlot(ClientClass::Debug, 20);
+  SessionParameters params = SessionParameters::makeParameters("KSA", "#5");
+  Session unscheduled = Session(params);
+  BOOST_CHECK_EQUAL(unscheduled.getSlotTimeLeft(), -1);
+  Session fred = Session(params.setSchedule(schedule));
+  Session debug = Session(params.setClientClass(ClientClass::Debug));
+  BOOST_CHECK_THROW(Session(params.setClientClass(ClientClass::Monitoring)), ParameterException);
+
+  // Early in FRED's slot, debug tools wait for theirs
+  while (fred.getSlotTimeLeft() < 70) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_CHECK(!debug.start());
+  BOOST_CHECK(!debug.timedStart(10));
+  BOOST_CHECK(debug.timedStart(200));
+  BOOST_CHECK(debug.getSlotTimeLeft() > 0 && debug.getSlotTimeLeft() <= 20);
+  BOOST_CHECK_EQUAL(fred.getSlotTimeLeft(), 0);
+  debug.stop();
+
+  // And the other way around
+  BOOST_CHECK(!fred.start());
+  BOOST_CHECK(fred.timedStart(200));
+  BOOST_CHECK(fred.getSlotTimeLeft() > 50 && fred.getSlotTimeLeft() <= 80);
+  fred.stop();
+  BOOST_CHECK(!debug.start());
+
+  // A waiter kept from the card through its slot stays queued, but doesn't hold back the next class
+  while (fred.getSlotTimeLeft() < 70) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_CHECK(unscheduled.start());
+  std::atomic<bool> debugStarted{ false };
+  std::thread debugThread([&]() {
+    debugStarted = debug.timedStart(400);
+    debug.stop();
+  });
+  while (fred.getSlotTimeLeft() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  while (fred.getSlotTimeLeft() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  unscheduled.stop();
+  BOOST_CHECK(fred.start());
+  fred.stop();
+  debugThread.join();
+  BOOST_CHECK(debugStarted);
+}
+
+BOOST_AUTO_TEST_CASE(CardSchedules)
+{
+  LockTypeOverride environment(nullptr); // The BasicSession uses the SocketLock
+  SessionParameters params = SessionParameters::makeParameters("KSA", "10240:0");
+  Session unscheduled = Session(params);
+  auto schedule = Schedule().addSlot(ClientClass::Debug, 50).addSlot(ClientClass::Control, 50);
+  {
+    // The Schedule is the card's, set once by its owners, and followed by the other Sessions
+    Session owner = Session(SessionParameters(params).setSchedule(schedule));
+    Session sameOwner = Session(SessionParameters(params).setSchedule(schedule));
+    BOOST_CHECK_THROW(Session(SessionParameters(params).setSchedule(Schedule().addSlot(ClientClass::Control, 10))), ParameterException);
+    BOOST_CHECK_THROW(Session(SessionParameters(params).setClientClass(ClientClass::Monitoring)), ParameterException);
+    BasicSession<SocketLock> basic(params);
+
+    // Early in the slot of the debug tools
+    Session debug = Session(SessionParameters(params).setClientClass(ClientClass::Debug));
+    while (debug.getSlotTimeLeft() < 40) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_CHECK(!unscheduled.start());
+    BOOST_CHECK(!basic.start());
+    BOOST_CHECK(debug.start());
+    debug.stop();
+    BOOST_CHECK(unscheduled.timedStart(200));
+    BOOST_CHECK(unscheduled.getSlotTimeLeft() > 0);
+    unscheduled.stop();
+    BOOST_CHECK(basic.start());
+    basic.stop();
+  }
+
+  // Gone with its owners
+  BOOST_CHECK_EQUAL(unscheduled.getSlotTimeLeft(), -1);
+  Session owner = Session(params.setSchedule(Schedule().addSlot(ClientClass::Control, 10)));
+  BOOST_CHECK_NE(unscheduled.getSlotTimeLeft(), -1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()